@@ -0,0 +1,87 @@
+// 比较 CAsyncLog 在调用线程上的开销：LOGI 当场格式化，DLOGI 只复制参数，
+// FLOGI 用 "{}" 格式串当场格式化。
+// 日志写入 /tmp 下的二进制文件，不输出到控制台；结束后删除日志文件
+#include <benchmark/benchmark.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <filesystem>
+#include <string>
+
+#include "playground/threading/async_log.h"
+
+using namespace playground;
+
+namespace {
+std::string logBaseName() {
+  return "/tmp/async_log_benchmark_" + std::to_string(::getpid());
+}
+
+// Setup / Teardown 在每组参数的所有线程开始前、结束后各调用一次
+void startLog(const benchmark::State&) {
+  CAsyncLog::setConsoleEcho(false);
+  CAsyncLog::setBinaryFile(true);
+  CAsyncLog::setFlushPolicy(LOG_FLUSH_BYTES, 1024);
+  CAsyncLog::init(logBaseName().c_str());
+}
+
+void stopLog(const benchmark::State&) {
+  CAsyncLog::uninit();
+
+  namespace fs = std::filesystem;
+  const std::string strPrefix = fs::path(logBaseName()).filename().string();
+  for (const auto& entry : fs::directory_iterator("/tmp")) {
+    if (entry.path().filename().string().rfind(strPrefix, 0) == 0) {
+      fs::remove(entry.path());
+    }
+  }
+}
+}  // namespace
+
+static void BM_LogText(benchmark::State& state) {
+  int i = 0;
+  for (auto _ : state) {
+    LOGI("request id=%d user=%s latency=%.3f ms", i++, "alice", 1.25);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+static void BM_LogDeferred(benchmark::State& state) {
+  int i = 0;
+  for (auto _ : state) {
+    DLOGI("request id=%d user=%s latency=%.3f ms", i++, "alice", 1.25);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+static void BM_LogFormat(benchmark::State& state) {
+  int i = 0;
+  for (auto _ : state) {
+    FLOGI("request id={} user={} latency={} ms", i++, "alice", 1.25);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+// 只构造前缀：[级别][时间][线程号]
+static void BM_LogPrefix(benchmark::State& state) {
+  std::string strPrefix;
+  for (auto _ : state) {
+    strPrefix.clear();
+    const auto now = std::chrono::system_clock::now().time_since_epoch();
+    appendLogPrefix(
+        strPrefix, LOG_LEVEL_INFO,
+        std::chrono::duration_cast<std::chrono::microseconds>(now).count(),
+        12345);
+    benchmark::DoNotOptimize(strPrefix.data());
+  }
+}
+
+BENCHMARK(BM_LogPrefix);
+BENCHMARK(BM_LogText)->Setup(startLog)->Teardown(stopLog)->ThreadRange(1, 4);
+BENCHMARK(BM_LogFormat)->Setup(startLog)->Teardown(stopLog)->ThreadRange(1, 4);
+BENCHMARK(BM_LogDeferred)
+    ->Setup(startLog)
+    ->Teardown(stopLog)
+    ->ThreadRange(1, 4);
+
+BENCHMARK_MAIN();
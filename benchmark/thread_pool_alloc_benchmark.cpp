@@ -0,0 +1,112 @@
+// 统计 ThreadPool::addTask 稳态下每个任务的堆分配次数
+// 通过替换全局 operator new/delete 计数，结果以 allocs_per_task 计数器输出
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <functional>
+#include <future>
+#include <memory>
+#include <new>
+
+#include "playground/threading/thread_pool.h"
+
+namespace {
+std::atomic<size_t> g_allocations{0};
+}  // namespace
+
+void* operator new(std::size_t size) {
+  g_allocations.fetch_add(1, std::memory_order_relaxed);
+  if (void* p = std::malloc(size ? size : 1)) return p;
+  throw std::bad_alloc();
+}
+void* operator new[](std::size_t size) { return ::operator new(size); }
+void* operator new(std::size_t size, std::align_val_t align) {
+  g_allocations.fetch_add(1, std::memory_order_relaxed);
+  const auto alignment = static_cast<std::size_t>(align);
+  if (void* p = std::aligned_alloc(
+          alignment, (size + alignment - 1) / alignment * alignment)) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+// 上面的 new 都用 malloc / aligned_alloc 分配，这里用 free 释放是配对的。
+// GCC 把 delete 内联到调用处后只看到 operator new 的结果被 free，
+// 会误报 -Wmismatched-new-delete，只在这一处关掉；其余 delete 都转发到这里
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+void operator delete(void* p) noexcept { std::free(p); }
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+void operator delete(void* p, std::size_t) noexcept { ::operator delete(p); }
+void operator delete[](void* p) noexcept { ::operator delete(p); }
+void operator delete[](void* p, std::size_t) noexcept { ::operator delete(p); }
+void operator delete(void* p, std::align_val_t) noexcept {
+  ::operator delete(p);
+}
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept {
+  ::operator delete(p);
+}
+
+namespace {
+constexpr int kTasksPerIteration = 1'000;
+
+// 改造前 addTask 的打包方式：
+// make_shared<packaged_task> + std::bind + std::function
+template <typename F>
+std::future<int> packageLikeBefore(F&& fn, std::function<void()>& slot) {
+  auto task = std::make_shared<std::packaged_task<int()>>(
+      std::bind(std::forward<F>(fn)));
+  std::future<int> res = task->get_future();
+  slot = [task] { (*task)(); };
+  return res;
+}
+
+void BM_PackagedTask(benchmark::State& state) {
+  int value = 1;
+  std::function<void()> slot;
+  size_t allocations = 0;
+  for (auto _ : state) {
+    const size_t before = g_allocations.load(std::memory_order_relaxed);
+    for (int i = 0; i < kTasksPerIteration; i++) {
+      auto fut = packageLikeBefore([&value] { return value; }, slot);
+      slot();
+      benchmark::DoNotOptimize(fut.get());
+    }
+    allocations += g_allocations.load(std::memory_order_relaxed) - before;
+  }
+  state.counters["allocs_per_task"] = static_cast<double>(allocations) /
+                                      (state.iterations() * kTasksPerIteration);
+}
+
+void BM_ThreadPoolAddTask(benchmark::State& state) {
+  playground::ThreadPool pool(static_cast<unsigned int>(state.range(0)));
+  int value = 1;
+  std::vector<playground::TaskFuture<int>> futures(kTasksPerIteration);
+
+  // 预热：让回收池、工作队列的环形数组扩容到稳定大小
+  for (int round = 0; round < 4; round++) {
+    for (auto& fut : futures) fut = pool.addTask([&value] { return value; });
+    for (auto& fut : futures) fut.get();
+  }
+
+  size_t allocations = 0;
+  for (auto _ : state) {
+    const size_t before = g_allocations.load(std::memory_order_relaxed);
+    for (auto& fut : futures) fut = pool.addTask([&value] { return value; });
+    for (auto& fut : futures) benchmark::DoNotOptimize(fut.get());
+    allocations += g_allocations.load(std::memory_order_relaxed) - before;
+  }
+  state.counters["allocs_per_task"] = static_cast<double>(allocations) /
+                                      (state.iterations() * kTasksPerIteration);
+  state.SetItemsProcessed(state.iterations() * kTasksPerIteration);
+}
+}  // namespace
+
+BENCHMARK(BM_PackagedTask);
+BENCHMARK(BM_ThreadPoolAddTask)->Arg(1)->Arg(4)->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,253 @@
+// ThreadPool 扩展性测试：按线程数扫描，对比单一全局队列与每线程队列 + 任务窃取
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+#include "playground/threading/thread_pool.h"
+
+namespace {
+constexpr int kTasksPerIteration = 10'000;
+constexpr int kSpawnFanOut = 64;
+
+// 改造前的实现：所有线程共享一个 std::queue，由同一把锁保护，作为对照组
+class SingleQueuePool {
+ public:
+  explicit SingleQueuePool(unsigned int num) {
+    // 与 ThreadPool 一致：线程数不超过硬件并发数的两倍
+    const unsigned int hardware_threads = std::thread::hardware_concurrency();
+    if (hardware_threads != 0 && num > hardware_threads * 2) {
+      num = hardware_threads * 2;
+    }
+    for (unsigned int i = 0; i < num; i++) {
+      threads_.emplace_back([this] {
+        while (true) {
+          std::function<void()> task;
+          {
+            std::unique_lock<std::mutex> lock(mtx_);
+            cv_.wait(lock, [this] { return !tasks_.empty() || stop_; });
+            if (tasks_.empty() && stop_) break;
+            task = std::move(tasks_.front());
+            tasks_.pop();
+          }
+          task();
+        }
+      });
+    }
+  }
+  ~SingleQueuePool() {
+    {
+      std::lock_guard<std::mutex> lock(mtx_);
+      stop_ = true;
+    }
+    cv_.notify_all();
+    for (auto& th : threads_) th.join();
+  }
+
+  // 改造前 ThreadPool::addTask 的任务打包方式（packaged_task + std::function）
+  template <typename F>
+  auto addTask(F&& fn) -> std::future<std::invoke_result_t<F>> {
+    using R = std::invoke_result_t<F>;
+    auto task = std::make_shared<std::packaged_task<R()>>(std::forward<F>(fn));
+    std::future<R> res = task->get_future();
+    {
+      std::lock_guard<std::mutex> lock(mtx_);
+      tasks_.push([task] { (*task)(); });
+    }
+    cv_.notify_one();
+    return res;
+  }
+
+ private:
+  std::vector<std::thread> threads_;
+  std::queue<std::function<void()>> tasks_;
+  std::condition_variable cv_;
+  std::mutex mtx_;
+  bool stop_ = false;
+};
+
+void waitUntil(const std::atomic<int>& counter, int expected) {
+  while (counter.load(std::memory_order_acquire) != expected) {
+    std::this_thread::yield();
+  }
+}
+
+// 外部线程提交大量极短任务
+template <typename Pool>
+void BM_ExternalSubmit(benchmark::State& state) {
+  Pool pool(static_cast<unsigned int>(state.range(0)));
+  std::atomic<int> done{0};
+  for (auto _ : state) {
+    done = 0;
+    for (int i = 0; i < kTasksPerIteration; i++) {
+      pool.addTask([&done] { done.fetch_add(1, std::memory_order_release); });
+    }
+    waitUntil(done, kTasksPerIteration);
+  }
+  state.SetItemsProcessed(state.iterations() * kTasksPerIteration);
+}
+
+// 任务在工作线程内部继续派生子任务，衡量本地提交 + 窃取的收益
+template <typename Pool>
+void BM_WorkerSpawn(benchmark::State& state) {
+  Pool pool(static_cast<unsigned int>(state.range(0)));
+  std::atomic<int> done{0};
+  const int roots = kTasksPerIteration / kSpawnFanOut;
+  for (auto _ : state) {
+    done = 0;
+    for (int i = 0; i < roots; i++) {
+      pool.addTask([&pool, &done] {
+        for (int j = 0; j < kSpawnFanOut; j++) {
+          pool.addTask(
+              [&done] { done.fetch_add(1, std::memory_order_release); });
+        }
+      });
+    }
+    waitUntil(done, roots * kSpawnFanOut);
+  }
+  state.SetItemsProcessed(state.iterations() * roots * kSpawnFanOut);
+}
+
+// 10 万个小任务：逐个 addTask、一次 addTasks、parallelFor 三种提交方式对比
+constexpr int kFanOutItems = 100'000;
+
+void BM_FanOutAddTask(benchmark::State& state) {
+  playground::ThreadPool pool(static_cast<unsigned int>(state.range(0)));
+  std::atomic<int> done{0};
+  for (auto _ : state) {
+    done = 0;
+    for (int i = 0; i < kFanOutItems; i++) {
+      pool.addTask([&done] { done.fetch_add(1, std::memory_order_release); });
+    }
+    waitUntil(done, kFanOutItems);
+  }
+  state.SetItemsProcessed(state.iterations() * kFanOutItems);
+}
+
+void BM_FanOutAddTasks(benchmark::State& state) {
+  playground::ThreadPool pool(static_cast<unsigned int>(state.range(0)));
+  std::atomic<int> done{0};
+  std::vector<std::function<void()>> tasks(
+      kFanOutItems,
+      [&done] { done.fetch_add(1, std::memory_order_relaxed); });
+  for (auto _ : state) {
+    pool.addTasks(tasks).wait();
+  }
+  state.SetItemsProcessed(state.iterations() * kFanOutItems);
+}
+
+void BM_FanOutParallelFor(benchmark::State& state) {
+  playground::ThreadPool pool(static_cast<unsigned int>(state.range(0)));
+  std::vector<int> data(kFanOutItems);
+  for (auto _ : state) {
+    pool.parallelFor(0, kFanOutItems, 256, [&data](int i) { data[i]++; })
+        .wait();
+  }
+  benchmark::DoNotOptimize(data.data());
+  state.SetItemsProcessed(state.iterations() * kFanOutItems);
+}
+
+// 单个任务从提交到开始执行的往返延迟，按 spin_count 扫描：
+// 0 表示空闲线程立即休眠，每个任务都需要一次 futex 唤醒
+void BM_DispatchLatency(benchmark::State& state) {
+  playground::ThreadPoolOptions options;
+  options.spin_count = static_cast<unsigned int>(state.range(0));
+  playground::ThreadPool pool(options);
+  for (auto _ : state) {
+    pool.addTask([] {}).get();
+  }
+}
+
+// 多个外部线程同时提交：互斥队列与无锁环对比。
+// 由 benchmark 框架启动 N 个生产者线程，共用同一个线程池
+constexpr int kTasksPerProducer = 1000;
+
+template <playground::QueueBackend Backend>
+playground::ThreadPool& sharedPool() {
+  static playground::ThreadPool pool([] {
+    playground::ThreadPoolOptions options;
+    options.min_threads = std::thread::hardware_concurrency();
+    options.max_threads = options.min_threads;
+    options.backend = Backend;
+    return options;
+  }());
+  return pool;
+}
+
+template <playground::QueueBackend Backend>
+void BM_ConcurrentProducers(benchmark::State& state) {
+  playground::ThreadPool& pool = sharedPool<Backend>();
+  std::atomic<int> done{0};
+  for (auto _ : state) {
+    done = 0;
+    for (int i = 0; i < kTasksPerProducer; i++) {
+      pool.addTask([&done] { done.fetch_add(1, std::memory_order_release); });
+    }
+    waitUntil(done, kTasksPerProducer);
+  }
+  state.SetItemsProcessed(state.iterations() * kTasksPerProducer);
+}
+
+// 在已有 N 个未到期定时器的时间轮上添加并取消一个定时器
+void BM_TimerInsertCancel(benchmark::State& state) {
+  playground::ThreadPool pool(1);
+  std::vector<playground::ThreadPool::TimerHandle> pending;
+  for (int64_t i = 0; i < state.range(0); i++) {
+    pending.push_back(
+        pool.addTaskAfter(std::chrono::seconds(60 + i % 3600), [] {}));
+  }
+  for (auto _ : state) {
+    pool.addTaskAfter(std::chrono::seconds(30), [] {}).cancel();
+  }
+}
+}  // namespace
+
+BENCHMARK_TEMPLATE(BM_ExternalSubmit, SingleQueuePool)
+    ->RangeMultiplier(2)
+    ->Range(1, 64)
+    ->UseRealTime();
+BENCHMARK_TEMPLATE(BM_ExternalSubmit, playground::ThreadPool)
+    ->RangeMultiplier(2)
+    ->Range(1, 64)
+    ->UseRealTime();
+BENCHMARK_TEMPLATE(BM_WorkerSpawn, SingleQueuePool)
+    ->RangeMultiplier(2)
+    ->Range(1, 64)
+    ->UseRealTime();
+BENCHMARK_TEMPLATE(BM_WorkerSpawn, playground::ThreadPool)
+    ->RangeMultiplier(2)
+    ->Range(1, 64)
+    ->UseRealTime();
+
+BENCHMARK(BM_FanOutAddTask)->RangeMultiplier(4)->Range(1, 64)->UseRealTime();
+BENCHMARK(BM_FanOutAddTasks)->RangeMultiplier(4)->Range(1, 64)->UseRealTime();
+BENCHMARK(BM_FanOutParallelFor)
+    ->RangeMultiplier(4)
+    ->Range(1, 64)
+    ->UseRealTime();
+BENCHMARK(BM_DispatchLatency)->Arg(0)->Arg(1000)->Arg(10000)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_ConcurrentProducers,
+                   playground::QueueBackend::kMutexDeque)
+    ->Threads(1)
+    ->Threads(8)
+    ->Threads(32)
+    ->Threads(64)
+    ->UseRealTime();
+BENCHMARK_TEMPLATE(BM_ConcurrentProducers,
+                   playground::QueueBackend::kLockFreeRing)
+    ->Threads(1)
+    ->Threads(8)
+    ->Threads(32)
+    ->Threads(64)
+    ->UseRealTime();
+BENCHMARK(BM_TimerInsertCancel)->Arg(0)->Arg(1000)->Arg(300000);
+
+BENCHMARK_MAIN();
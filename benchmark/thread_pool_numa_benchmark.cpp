@@ -0,0 +1,61 @@
+// 绑核策略对访存密集型负载的影响：每个任务反复扫描自己那一段数组。
+// 数组由同一批任务首次写入（first-touch），页面分配在写入线程所在的节点上；
+// 绑核后线程不会被迁移到别的节点，之后的扫描都是本地访存
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "playground/threading/thread_pool.h"
+
+namespace {
+constexpr size_t kBytesPerWorker = 32 << 20;
+
+void BM_PartitionedScan(benchmark::State& state) {
+  const auto placement =
+      static_cast<playground::WorkerPlacement>(state.range(0));
+  const unsigned int threads =
+      std::max(1u, std::thread::hardware_concurrency());
+  playground::ThreadPoolOptions options;
+  options.min_threads = threads;
+  options.max_threads = threads;
+  options.placement = placement;
+  playground::ThreadPool pool(options);
+
+  // 任务数等于线程数且耗时相同：一次批量提交中第 k 个任务总落在同一个队列，
+  // 基本不发生窃取，每段数据始终由同一个线程处理
+  const size_t per_worker = kBytesPerWorker / sizeof(long);
+  std::unique_ptr<long[]> data(new long[per_worker * threads]);
+  std::vector<long> sums(threads);
+  auto run = [&](auto&& body) {
+    std::vector<std::function<void()>> tasks;
+    for (unsigned int part = 0; part < threads; part++) {
+      tasks.emplace_back([&body, part] { body(part); });
+    }
+    pool.addTasks(tasks).wait();
+  };
+
+  run([&](unsigned int part) {
+    long* first = data.get() + part * per_worker;
+    for (size_t i = 0; i < per_worker; i++) first[i] = static_cast<long>(i);
+  });
+  for (auto _ : state) {
+    run([&](unsigned int part) {
+      const long* first = data.get() + part * per_worker;
+      long sum = 0;
+      for (size_t i = 0; i < per_worker; i++) sum += first[i];
+      sums[part] = sum;
+    });
+    benchmark::DoNotOptimize(sums.data());
+  }
+  state.SetBytesProcessed(state.iterations() * kBytesPerWorker * threads);
+}
+}  // namespace
+
+// 0 = kNone，1 = kCompact，2 = kScatter
+BENCHMARK(BM_PartitionedScan)->DenseRange(0, 2)->UseRealTime();
+
+BENCHMARK_MAIN();
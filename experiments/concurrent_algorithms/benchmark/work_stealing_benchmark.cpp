@@ -0,0 +1,115 @@
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <future>
+#include <vector>
+
+#include "concurrent/thread_pool.hpp"
+
+using playground::experiments::parallel::ThreadPool;
+
+// 外部提交 kRoots 个根任务，每个根任务在工作线程内再提交 range(0) 个子任务，
+// 边执行待处理任务边等待子任务完成。
+// 计数器展示本地提交在各工作线程队列上的分布：
+// workers_pushing 为有本地提交的线程数，max_share 为单个队列承担的最大比例；
+// steal_hit 与 per_steal 反映工作线程窃取的效果
+static void BM_LocalFanOut(benchmark::State& state) {
+  constexpr int kRoots = 16;
+  const int children = static_cast<int>(state.range(0));
+  ThreadPool pool(4);
+  const ThreadPool::Stats before = pool.GetStats();
+
+  for (auto _ : state) {
+    std::vector<std::future<int>> roots;
+    for (int r = 0; r < kRoots; r++) {
+      roots.push_back(pool.AddTask([&pool, children] {
+        std::vector<std::future<int>> futures;
+        for (int c = 0; c < children; c++) {
+          futures.push_back(pool.AddTask([c] { return c; }));
+        }
+        int sum = 0;
+        for (auto& fut : futures) {
+          while (fut.wait_for(std::chrono::seconds(0)) !=
+                 std::future_status::ready) {
+            pool.RunPendingTasks();
+          }
+          sum += fut.get();
+        }
+        return sum;
+      }));
+    }
+    for (auto& root : roots) benchmark::DoNotOptimize(root.get());
+  }
+
+  const ThreadPool::Stats after = pool.GetStats();
+  std::uint64_t total = 0;
+  std::uint64_t most = 0;
+  int pushing = 0;
+  std::uint64_t attempts = 0;
+  std::uint64_t steals = 0;
+  std::uint64_t stolen = 0;
+  for (size_t i = 0; i < after.local_pushes.size(); i++) {
+    const std::uint64_t pushes =
+        after.local_pushes[i] - before.local_pushes[i];
+    total += pushes;
+    most = std::max(most, pushes);
+    pushing += pushes > 0;
+    attempts += after.steal_attempts[i] - before.steal_attempts[i];
+    steals += after.steals[i] - before.steals[i];
+    stolen += after.stolen_tasks[i] - before.stolen_tasks[i];
+  }
+  state.counters["workers_pushing"] = pushing;
+  state.counters["max_share"] =
+      total ? static_cast<double>(most) / static_cast<double>(total) : 0;
+  // 窃取成功率，以及平均每次成功窃取取得的任务数
+  state.counters["steal_hit"] =
+      attempts ? static_cast<double>(steals) / static_cast<double>(attempts)
+               : 0;
+  state.counters["per_steal"] =
+      steals ? static_cast<double>(stolen) / static_cast<double>(steals) : 0;
+  state.SetItemsProcessed(state.iterations() * kRoots * (children + 1));
+}
+
+// 两个线程池同时运行，各自的工作线程只压入本池的队列
+static void BM_TwoPoolsFanOut(benchmark::State& state) {
+  ThreadPool first(2);
+  ThreadPool second(2);
+  for (auto _ : state) {
+    auto a = first.AddTask([&first, &second] {
+      auto local = first.AddTask([] { return 1; });
+      auto remote = second.AddTask([] { return 2; });
+      while (local.wait_for(std::chrono::seconds(0)) !=
+             std::future_status::ready) {
+        first.RunPendingTasks();
+      }
+      return local.get() + remote.get();
+    });
+    benchmark::DoNotOptimize(a.get());
+  }
+}
+
+// 递归 fork-join：ParallelInvoke 等待时帮忙执行任务，不需要调用方轮询
+static long Fib(ThreadPool& pool, int n) {
+  if (n < 2) return n;
+  if (n < 16) return Fib(pool, n - 1) + Fib(pool, n - 2);
+  long a = 0;
+  long b = 0;
+  playground::experiments::parallel::ParallelInvoke(
+      pool, [&] { a = Fib(pool, n - 1); }, [&] { b = Fib(pool, n - 2); });
+  return a + b;
+}
+
+static void BM_ParallelInvokeFib(benchmark::State& state) {
+  ThreadPool pool;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(Fib(pool, static_cast<int>(state.range(0))));
+  }
+}
+
+BENCHMARK(BM_LocalFanOut)->Arg(16)->Arg(256)->UseRealTime();
+BENCHMARK(BM_TwoPoolsFanOut)->UseRealTime();
+BENCHMARK(BM_ParallelInvokeFib)->Arg(25)->Arg(30)->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,133 @@
+#ifndef PLAYGROUND_EXPERIMENTS_CONCURRENT_CHASE_LEV_DEQUE_H_
+#define PLAYGROUND_EXPERIMENTS_CONCURRENT_CHASE_LEV_DEQUE_H_
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <type_traits>
+#include <vector>
+
+namespace playground::experiments::parallel {
+// Chase-Lev 工作窃取双端队列，内存序参考 Lê 等人的 C11 版本
+// （"Correct and Efficient Work-Stealing for Weak Memory Models"）。
+// - 只有所属线程调用 Push / TryPop，在 bottom 端后进先出，通常无需原子 RMW；
+// - 其他线程调用 TrySteal，在 top 端先进先出，通过 CAS 推进 top；
+// - 两端只在最后一个元素上竞争，此时所属线程同样用 CAS 裁决。
+// 环形数组写满时由所属线程扩容为两倍，旧数组保留到析构，窃取者可能仍在读取。
+// 元素按值在线程间复制，必须可平凡复制（通常存指针）
+template <typename T>
+class ChaseLevDeque {
+  static_assert(std::is_trivially_copyable_v<T>,
+                "ChaseLevDeque stores trivially copyable values");
+
+ public:
+  // 初始容量向上取整到 2 的幂
+  explicit ChaseLevDeque(std::size_t capacity = 64) {
+    std::size_t size = 2;
+    while (size < capacity) size *= 2;
+    arrays_.push_back(std::make_unique<Array>(size));
+    array_.store(arrays_.back().get(), std::memory_order_relaxed);
+  }
+  ChaseLevDeque(const ChaseLevDeque&) = delete;
+  ChaseLevDeque& operator=(const ChaseLevDeque&) = delete;
+
+  // 仅所属线程调用
+  void Push(T value) {
+    const std::int64_t b = bottom_.load(std::memory_order_relaxed);
+    const std::int64_t t = top_.load(std::memory_order_acquire);
+    Array* array = array_.load(std::memory_order_relaxed);
+    if (b - t > static_cast<std::int64_t>(array->mask)) {
+      array = Grow(array, t, b);
+    }
+    array->Put(b, value);
+    // release：窃取者读到新的 bottom 时也能看到元素及其指向的数据
+    bottom_.store(b + 1, std::memory_order_release);
+  }
+
+  // 仅所属线程调用，取最近压入的元素
+  std::optional<T> TryPop() {
+    const std::int64_t b = bottom_.load(std::memory_order_relaxed) - 1;
+    Array* array = array_.load(std::memory_order_relaxed);
+    bottom_.store(b, std::memory_order_relaxed);
+    // 先公布 bottom 再读 top，与 TrySteal 中先读 top 再读 bottom 配对
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    std::int64_t t = top_.load(std::memory_order_relaxed);
+
+    if (t > b) {  // 队列为空
+      bottom_.store(b + 1, std::memory_order_relaxed);
+      return std::nullopt;
+    }
+    T value = array->Get(b);
+    if (t == b) {
+      // 只剩最后一个元素，与窃取者竞争
+      const bool won = top_.compare_exchange_strong(
+          t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+      bottom_.store(b + 1, std::memory_order_relaxed);
+      if (!won) return std::nullopt;
+    }
+    return value;
+  }
+
+  // 任意线程调用，取最早压入的元素。与其他线程竞争失败时同样返回空
+  std::optional<T> TrySteal() {
+    std::int64_t t = top_.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    const std::int64_t b = bottom_.load(std::memory_order_acquire);
+    if (t >= b) return std::nullopt;
+
+    Array* array = array_.load(std::memory_order_acquire);
+    T value = array->Get(t);
+    if (!top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                      std::memory_order_relaxed)) {
+      return std::nullopt;
+    }
+    return value;
+  }
+
+  // 近似值，并发修改时仅供参考
+  bool Empty() const {
+    return bottom_.load(std::memory_order_relaxed) <=
+           top_.load(std::memory_order_relaxed);
+  }
+
+  std::size_t Size() const {
+    const std::int64_t size = bottom_.load(std::memory_order_relaxed) -
+                              top_.load(std::memory_order_relaxed);
+    return size > 0 ? static_cast<std::size_t>(size) : 0;
+  }
+
+ private:
+  struct Array {
+    explicit Array(std::size_t size)
+        : mask(size - 1), slots(new std::atomic<T>[size]) {}
+
+    T Get(std::int64_t index) const {
+      return slots[index & mask].load(std::memory_order_relaxed);
+    }
+    void Put(std::int64_t index, T value) {
+      slots[index & mask].store(value, std::memory_order_relaxed);
+    }
+
+    const std::size_t mask;
+    std::unique_ptr<std::atomic<T>[]> slots;
+  };
+
+  Array* Grow(Array* old, std::int64_t top, std::int64_t bottom) {
+    auto array = std::make_unique<Array>((old->mask + 1) * 2);
+    for (std::int64_t i = top; i < bottom; i++) array->Put(i, old->Get(i));
+    arrays_.push_back(std::move(array));
+    Array* grown = arrays_.back().get();
+    array_.store(grown, std::memory_order_release);
+    return grown;
+  }
+
+  // top 由窃取者争抢，bottom 只由所属线程写入，分处不同缓存行
+  alignas(64) std::atomic<std::int64_t> top_{0};
+  alignas(64) std::atomic<std::int64_t> bottom_{0};
+  std::atomic<Array*> array_;
+  // 当前及历次扩容前的数组，只由所属线程修改
+  std::vector<std::unique_ptr<Array>> arrays_;
+};
+}  // namespace playground::experiments::parallel
+#endif
@@ -0,0 +1,61 @@
+#ifndef PLAYGROUND_EXPERIMENTS_CONCURRENT_EVENT_COUNT_H_
+#define PLAYGROUND_EXPERIMENTS_CONCURRENT_EVENT_COUNT_H_
+#include <atomic>
+#include <cstdint>
+
+namespace playground::experiments::parallel {
+// 事件计数器：让等待方在“检查条件”与“休眠”之间不丢失通知，
+// 而通知方在没有等待者时只需一次内存屏障和一次读取。
+// 等待方的用法：
+//   auto key = ec.PrepareWait();
+//   if (条件已满足) { ec.CancelWait(); } else { ec.Wait(key); }
+// 通知方先让条件成立（例如任务入队），再调用 NotifyOne / NotifyAll。
+// 休眠基于 std::atomic::wait，Linux 上即 futex
+class EventCount {
+ public:
+  using Key = std::uint32_t;
+
+  EventCount() = default;
+  EventCount(const EventCount&) = delete;
+  EventCount& operator=(const EventCount&) = delete;
+
+  Key PrepareWait() {
+    waiters_.fetch_add(1, std::memory_order_seq_cst);
+    // 与通知方的屏障配对：要么等待方看到条件成立，要么通知方看到等待者
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    return epoch_.load(std::memory_order_acquire);
+  }
+
+  void CancelWait() { waiters_.fetch_sub(1, std::memory_order_relaxed); }
+
+  // PrepareWait 之后有过通知则立即返回
+  void Wait(Key key) {
+    epoch_.wait(key, std::memory_order_acquire);
+    waiters_.fetch_sub(1, std::memory_order_relaxed);
+  }
+
+  void NotifyOne() {
+    if (HasWaiters()) {
+      epoch_.fetch_add(1, std::memory_order_release);
+      epoch_.notify_one();
+    }
+  }
+
+  void NotifyAll() {
+    if (HasWaiters()) {
+      epoch_.fetch_add(1, std::memory_order_release);
+      epoch_.notify_all();
+    }
+  }
+
+ private:
+  bool HasWaiters() const {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    return waiters_.load(std::memory_order_relaxed) != 0;
+  }
+
+  std::atomic<Key> epoch_{0};
+  std::atomic<std::uint32_t> waiters_{0};
+};
+}  // namespace playground::experiments::parallel
+#endif
@@ -1,5 +1,6 @@
 #ifndef PLAYGROUND_EXPERIMENTS_CONCURRENT_FOR_EACH_H_
 #define PLAYGROUND_EXPERIMENTS_CONCURRENT_FOR_EACH_H_
+#include <algorithm>
 #include <future>
 #include <iterator>
 #include <thread>
@@ -1,5 +1,7 @@
 #ifndef PLAYGROUND_EXPERIMENTS_CONCURRENT_SORT_H_
 #define PLAYGROUND_EXPERIMENTS_CONCURRENT_SORT_H_
+#include <algorithm>
+#include <functional>
 #include <future>
 #include <list>
 
@@ -104,19 +106,15 @@ class SorterThreadPool {
     // 前半部分排序
     std::list<T> lower_chunk;
     lower_chunk.splice(lower_chunk.begin(), list, list.begin(), divide_it);
-    auto lower_fut = pool_.AddTask(
+    auto lower = pool_.Spawn(
         std::bind(&SorterThreadPool::DoSort, this, std::move(lower_chunk)));
 
     // 后半部分排序
     std::list<T> sorted_higher = DoSort(std::move(list));
     res.splice(res.end(), sorted_higher);
 
-    // 任务窃取
-    while (lower_fut.wait_for(std::chrono::seconds(0)) !=
-           std::future_status::ready) {
-      pool_.RunPendingTasks();
-    }
-    res.splice(res.begin(), lower_fut.get());
+    // 等待期间执行其他任务
+    res.splice(res.begin(), lower.Join());
     return res;
   }
 
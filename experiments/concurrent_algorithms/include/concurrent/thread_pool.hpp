@@ -1,6 +1,8 @@
 #ifndef PLAYGROUND_EXPERIMENTS_CONCURRENT_THREAD_POOL_H_
 #define PLAYGROUND_EXPERIMENTS_CONCURRENT_THREAD_POOL_H_
 #include <atomic>
+#include <cstdint>
+#include <functional>
 #include <future>
 #include <memory>
 #include <queue>
@@ -9,6 +11,8 @@
 
 #include "playground/threading/threads_guard.hpp"
 #include "playground/threading/threadsafe_queue.hpp"
+#include "chase_lev_deque.hpp"
+#include "event_count.hpp"
 
 namespace playground::experiments::parallel {
 class FunctionWrapper {
@@ -31,6 +35,8 @@ class FunctionWrapper {
   void operator()() { impl_->call(); }
 
  private:
+  friend class WorkStealingQueue;
+
   struct ImpBase {
     virtual void call() = 0;
     virtual ~ImpBase() = default;
@@ -42,53 +48,82 @@ class FunctionWrapper {
     F f_;
   };
 
+  // WorkStealingQueue 以裸指针保存任务，出入队时转移所有权
+  explicit FunctionWrapper(ImpBase* impl) : impl_(impl) {}
+  ImpBase* Release() { return impl_.release(); }
+
   std::unique_ptr<ImpBase> impl_;
 };
 
+// 每个工作线程一个的任务队列，基于无锁的 ChaseLevDeque：
+// 所属线程调用 Push / TryPop，后进先出，递归拆分出的任务趁热执行；
+// 其他线程调用 TrySteal，先进先出，偷走的是最早拆分、通常也最大的任务
 class WorkStealingQueue {
  public:
   WorkStealingQueue() = default;
   WorkStealingQueue(const WorkStealingQueue&) = delete;
   WorkStealingQueue& operator=(const WorkStealingQueue&) = delete;
+  ~WorkStealingQueue() {
+    while (auto impl = deque_.TryPop()) {
+      DataType discard(*impl);
+    }
+  }
 
   using DataType = FunctionWrapper;
-  void Push(DataType&& task) {
-    std::lock_guard lock(mutex_);
-    queue_.push_back(std::move(task));
-  }
+  void Push(DataType&& task) { deque_.Push(task.Release()); }
 
-  bool Empty() const {
-    std::lock_guard lock(mutex_);
-    return queue_.empty();
-  }
+  bool Empty() const { return deque_.Empty(); }
 
   bool TryPop(DataType& task) {
-    std::lock_guard lock(mutex_);
-    if (queue_.empty()) {
+    auto impl = deque_.TryPop();
+    if (!impl) {
       return false;
     }
-
-    task = std::move(queue_.front());
-    queue_.pop_front();
+    task = DataType(*impl);
     return true;
   }
 
   bool TrySteal(DataType& task) {
-    std::lock_guard lock(mutex_);
-    if (queue_.empty()) {
+    auto impl = deque_.TrySteal();
+    if (!impl) {
       return false;
     }
-
-    task = std::move(queue_.back());
-    queue_.pop_back();
+    task = DataType(*impl);
     return true;
   }
 
+  // 批量窃取至多一半的任务：第一个放入 task，其余压入 thief（必须是调用线程
+  // 自己的队列，为空则只取一个）。返回取到的任务数。
+  // Chase-Lev 的 top 一次只能安全地推进 1，因此逐个 CAS 转移，
+  // 省下的是重复挑选受害者以及之后再次窃取的开销
+  std::size_t StealHalf(DataType& task, WorkStealingQueue* thief) {
+    const std::size_t half = (deque_.Size() + 1) / 2;
+    auto first = deque_.TrySteal();
+    if (!first) {
+      return 0;
+    }
+    task = DataType(*first);
+    std::size_t stolen = 1;
+    while (thief && stolen < half) {
+      auto impl = deque_.TrySteal();
+      if (!impl) {
+        break;
+      }
+      thief->deque_.Push(*impl);
+      stolen++;
+    }
+    return stolen;
+  }
+
+  std::size_t Size() const { return deque_.Size(); }
+
  private:
-  std::deque<DataType> queue_;
-  mutable std::mutex mutex_;
+  ChaseLevDeque<DataType::ImpBase*> deque_;
 };
 
+template <typename T>
+class JoinHandle;
+
 class ThreadPool {
  public:
   ThreadPool(unsigned thread_count = -1)
@@ -104,79 +139,324 @@ class ThreadPool {
     try {
       queues_.reserve(thread_count);
       threads_.reserve(thread_count);
+      // 先建好全部队列再启动线程，工作线程窃取时会遍历整个 queues_
       for (unsigned i = 0; i < thread_count; i++) {
         queues_.push_back(std::make_unique<WorkStealingQueue>());
+      }
+      counters_.reset(new WorkerCounters[thread_count]);
+      for (unsigned i = 0; i < thread_count; i++) {
         threads_.emplace_back(&ThreadPool::ThreadTask, this, i);
       }
     } catch (...) {
       done_ = true;  // 通知已有线程尽快退出
+      idle_workers_.NotifyAll();
       throw;
     }
   }
-  ~ThreadPool() { done_ = true; }
+  ~ThreadPool() {
+    done_ = true;
+    idle_workers_.NotifyAll();
+  }
 
   using TaskType = FunctionWrapper;
 
+  // 运行统计，以工作线程下标为序。各计数器独立读取，不是严格一致的快照
+  struct Stats {
+    // 工作线程压入自己队列的任务数
+    std::vector<std::uint64_t> local_pushes;
+    // 尝试窃取的受害者队列数、成功的窃取次数、窃取到的任务总数
+    // （一次批量窃取可取得多个任务）
+    std::vector<std::uint64_t> steal_attempts;
+    std::vector<std::uint64_t> steals;
+    std::vector<std::uint64_t> stolen_tasks;
+    // 非工作线程（例如在 RunPendingTasks 中帮忙的提交线程）的窃取，每次一个任务
+    std::uint64_t external_steal_attempts = 0;
+    std::uint64_t external_steals = 0;
+  };
+
+  unsigned ThreadCount() const { return queues_.size(); }
+
+  Stats GetStats() const {
+    Stats stats;
+    for (unsigned i = 0; i < queues_.size(); i++) {
+      const WorkerCounters& counters = counters_[i];
+      stats.local_pushes.push_back(
+          counters.local_pushes.load(std::memory_order_relaxed));
+      stats.steal_attempts.push_back(
+          counters.steal_attempts.load(std::memory_order_relaxed));
+      stats.steals.push_back(counters.steals.load(std::memory_order_relaxed));
+      stats.stolen_tasks.push_back(
+          counters.stolen_tasks.load(std::memory_order_relaxed));
+    }
+    stats.external_steal_attempts =
+        external_steal_attempts_.load(std::memory_order_relaxed);
+    stats.external_steals = external_steals_.load(std::memory_order_relaxed);
+    return stats;
+  }
+
   template <typename F>
   std::future<std::invoke_result_t<F>> AddTask(F&& f) {
     using ResultType = std::invoke_result_t<F>;
 
     std::packaged_task<ResultType()> task(std::move(f));
     std::future<ResultType> fut = task.get_future();
-    if (local_queue_) {
-      local_queue_->Push(TaskType(std::move(task)));
-    } else {
-      pool_work_queue_.push(TaskType(std::move(task)));
-    }
+    Submit(TaskType(std::move(task)));
     return fut;
   }
 
-  void RunPendingTasks() {
-    TaskType task;
-    if (PopTaskFromLocal(task) || PopTaskFromPool(task) ||
-        PopTaskFromOtherThread(task)) {
+  // 与 AddTask 相同，但返回 JoinHandle：等待时先帮忙执行池中的任务，
+  // 适合递归的分治任务
+  template <typename F>
+  JoinHandle<std::invoke_result_t<F>> Spawn(F&& f) {
+    using ResultType = std::invoke_result_t<F>;
+    using State = typename JoinHandle<ResultType>::State;
+
+    auto state = std::make_shared<State>();
+    std::packaged_task<ResultType()> task(std::forward<F>(f));
+    std::future<ResultType> fut = task.get_future();
+    Submit(TaskType([state, task = std::move(task)]() mutable {
       task();
-    } else {
+      state->done.store(1, std::memory_order_release);
+      state->done.notify_all();
+    }));
+    return JoinHandle<ResultType>(this, std::move(state), std::move(fut));
+  }
+
+  void RunPendingTasks() {
+    if (!TryRunPendingTask()) {
       std::this_thread::yield();
     }
   }
 
  private:
+  template <typename T>
+  friend class JoinHandle;
+
+  // 空闲线程休眠前让出 CPU 并重新检查任务的次数
+  static constexpr unsigned kSpinCount = 64;
+
+  void Submit(TaskType&& task) {
+    // 只有本池的工作线程压入自己的队列，其他线程（包括别的池的工作线程）
+    // 都放入全局队列
+    if (WorkStealingQueue* local_queue = LocalQueue()) {
+      local_queue->Push(std::move(task));
+      Bump(counters_[local_queue_index_].local_pushes);
+    } else {
+      pool_work_queue_.push(std::move(task));
+    }
+    // 只有存在休眠的线程时才需要唤醒，否则只是一次屏障加一次读取
+    idle_workers_.NotifyOne();
+  }
+
   void ThreadTask(unsigned my_index) {
+    local_pool_ = this;
     local_queue_index_ = my_index;
-    local_queue_ = queues_[my_index].get();
+    unsigned spins = 0;
     while (!done_) {
-      RunPendingTasks();
+      if (TryRunPendingTask()) {
+        spins = 0;
+        continue;
+      }
+      if (++spins < kSpinCount) {
+        std::this_thread::yield();
+        continue;
+      }
+      spins = 0;
+      // 登记为等待者之后再检查一次，AddTask 要么被这次检查看到，要么会唤醒本线程
+      const EventCount::Key key = idle_workers_.PrepareWait();
+      if (done_ || HasPendingTasks()) {
+        idle_workers_.CancelWait();
+        continue;
+      }
+      idle_workers_.Wait(key);
     }
   }
 
+  bool TryRunPendingTask() {
+    TaskType task;
+    if (PopTaskFromLocal(task) || PopTaskFromPool(task) ||
+        PopTaskFromOtherThread(task)) {
+      task();
+      return true;
+    }
+    return false;
+  }
+
+  bool HasPendingTasks() const {
+    if (!pool_work_queue_.empty()) {
+      return true;
+    }
+    for (const auto& queue : queues_) {
+      if (!queue->Empty()) {
+        return true;
+      }
+    }
+    return false;
+  }
+
   bool PopTaskFromLocal(TaskType& task) {
-    return local_queue_ && local_queue_->TryPop(task);
+    WorkStealingQueue* local_queue = LocalQueue();
+    return local_queue && local_queue->TryPop(task);
   }
 
   bool PopTaskFromPool(TaskType& task) {
     return pool_work_queue_.try_pop(task);
   }
 
+  // 从随机位置开始依次尝试其他队列，避免所有窃取者扎堆在同一个受害者上。
+  // 工作线程一次取走受害者至多一半的任务，多出的放入自己的队列
   bool PopTaskFromOtherThread(TaskType& task) {
-    for (int i = 0; i < queues_.size(); i++) {
-      int index = (local_queue_index_ + 1 + i) % queues_.size();
-      if (queues_[index]->TrySteal(task)) {
+    WorkStealingQueue* local_queue = LocalQueue();
+    const unsigned count = queues_.size();
+    const unsigned start = NextRandom() % count;
+    for (unsigned i = 0; i < count; i++) {
+      const unsigned index = (start + i) % count;
+      if (local_queue && index == local_queue_index_) {
+        continue;
+      }
+      if (!local_queue) {
+        external_steal_attempts_.fetch_add(1, std::memory_order_relaxed);
+        if (queues_[index]->TrySteal(task)) {
+          external_steals_.fetch_add(1, std::memory_order_relaxed);
+          return true;
+        }
+        continue;
+      }
+
+      WorkerCounters& counters = counters_[local_queue_index_];
+      Bump(counters.steal_attempts);
+      const std::size_t stolen = queues_[index]->StealHalf(task, local_queue);
+      if (stolen > 0) {
+        Bump(counters.steals);
+        Bump(counters.stolen_tasks, stolen);
+        // 本线程的队列里有了可供窃取的任务，唤醒一个休眠的线程来分担
+        if (stolen > 1) {
+          idle_workers_.NotifyOne();
+        }
         return true;
       }
     }
     return false;
   }
 
+  // 每个线程独立的 xorshift 随机数，用于选择窃取的起点
+  static std::uint32_t NextRandom() {
+    std::uint32_t x = rng_state_;
+    if (x == 0) {
+      // 首次使用时以线程 id 为种子，xorshift 的状态不能为 0
+      x = static_cast<std::uint32_t>(
+              std::hash<std::thread::id>()(std::this_thread::get_id())) |
+          1;
+    }
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    rng_state_ = x;
+    return x;
+  }
+
+  // 当前线程是本池的工作线程时返回它的队列，否则返回 nullptr
+  WorkStealingQueue* LocalQueue() const {
+    return local_pool_ == this ? queues_[local_queue_index_].get() : nullptr;
+  }
+
+  // 单写者计数器的累加，不需要带 lock 前缀的原子指令
+  static void Bump(std::atomic<std::uint64_t>& counter,
+                   std::uint64_t value = 1) {
+    counter.store(counter.load(std::memory_order_relaxed) + value,
+                  std::memory_order_relaxed);
+  }
+
+  // 只由对应的工作线程写入，按缓存行对齐，互不伪共享
+  struct alignas(64) WorkerCounters {
+    std::atomic<std::uint64_t> local_pushes{0};
+    std::atomic<std::uint64_t> steal_attempts{0};
+    std::atomic<std::uint64_t> steals{0};
+    std::atomic<std::uint64_t> stolen_tasks{0};
+  };
+
   // 成员的声明顺序很重要，决定析构时是否能读取合法数据
   std::atomic_bool done_;
+  EventCount idle_workers_;
   playground::ThreadsafeQueue<TaskType> pool_work_queue_;
   std::vector<std::unique_ptr<WorkStealingQueue>> queues_;
+  std::unique_ptr<WorkerCounters[]> counters_;
+  std::atomic<std::uint64_t> external_steal_attempts_{0};
+  std::atomic<std::uint64_t> external_steals_{0};
   std::vector<std::thread> threads_;
   playground::ThreadsGuard threads_guard_;
 
-  inline static unsigned local_queue_index_ = 0;
-  inline static WorkStealingQueue* local_queue_ = nullptr;
+  // 当前线程所属的线程池及其队列下标。WorkStealingQueue 的 Push / TryPop
+  // 只允许所属线程调用，因此既要按线程区分，也要按线程池区分：
+  // 一个池的工作线程向另一个池（例如任务内部创建的嵌套池）提交时不能用自己的队列
+  inline static thread_local const ThreadPool* local_pool_ = nullptr;
+  inline static thread_local unsigned local_queue_index_ = 0;
+  inline static thread_local std::uint32_t rng_state_ = 0;
 };
+
+// ThreadPool::Spawn 提交的任务的句柄。Wait / Join 不会干等：
+// 先执行本线程队列中的任务，再取全局队列、窃取其他线程的任务，
+// 都没有可做的任务时短暂让出 CPU，最后才休眠到任务完成
+template <typename T>
+class JoinHandle {
+ public:
+  JoinHandle() = default;
+
+  bool Valid() const { return state_ != nullptr; }
+  bool Ready() const {
+    return state_->done.load(std::memory_order_acquire) != 0;
+  }
+
+  void Wait() {
+    unsigned spins = 0;
+    while (!Ready()) {
+      if (pool_->TryRunPendingTask()) {
+        spins = 0;
+        continue;
+      }
+      if (++spins < ThreadPool::kSpinCount) {
+        std::this_thread::yield();
+        continue;
+      }
+      state_->done.wait(0, std::memory_order_acquire);
+    }
+  }
+
+  // 等待完成并取得结果，任务抛出的异常在这里重新抛出
+  T Join() {
+    Wait();
+    return future_.get();
+  }
+
+ private:
+  friend class ThreadPool;
+
+  struct State {
+    std::atomic<std::uint32_t> done{0};
+  };
+
+  JoinHandle(ThreadPool* pool, std::shared_ptr<State> state,
+             std::future<T> future)
+      : pool_(pool), state_(std::move(state)), future_(std::move(future)) {}
+
+  ThreadPool* pool_ = nullptr;
+  std::shared_ptr<State> state_;
+  std::future<T> future_;
+};
+
+// 并行执行 f 和 g：g 提交到线程池，f 在当前线程执行，然后帮忙等待 g 完成。
+// 两者的异常都会传播，f 抛出时仍会先等 g 结束，g 可以安全地引用调用方的局部变量
+template <typename F, typename G>
+void ParallelInvoke(ThreadPool& pool, F&& f, G&& g) {
+  JoinHandle<std::invoke_result_t<G>> handle =
+      pool.Spawn(std::forward<G>(g));
+  try {
+    std::forward<F>(f)();
+  } catch (...) {
+    handle.Wait();
+    throw;
+  }
+  handle.Join();
+}
 }  // namespace playground::experiments::parallel
 #endif
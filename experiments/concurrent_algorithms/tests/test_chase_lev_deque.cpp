@@ -0,0 +1,76 @@
+#include "concurrent/chase_lev_deque.hpp"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+using playground::experiments::parallel::ChaseLevDeque;
+
+TEST(ChaseLevDeque, OwnerPopsLifoThievesStealFifo) {
+  ChaseLevDeque<int> deque(2);
+  EXPECT_TRUE(deque.Empty());
+  EXPECT_FALSE(deque.TryPop().has_value());
+  EXPECT_FALSE(deque.TrySteal().has_value());
+
+  // 超过初始容量，触发扩容
+  for (int i = 0; i < 100; i++) deque.Push(i);
+  EXPECT_EQ(deque.Size(), 100u);
+  EXPECT_EQ(deque.TrySteal(), 0);
+  EXPECT_EQ(deque.TrySteal(), 1);
+  EXPECT_EQ(deque.TryPop(), 99);
+  EXPECT_EQ(deque.TryPop(), 98);
+  EXPECT_EQ(deque.Size(), 96u);
+
+  while (deque.TryPop()) {
+  }
+  EXPECT_TRUE(deque.Empty());
+  // 取空后 bottom 与 top 仍保持一致，可以继续使用
+  deque.Push(7);
+  EXPECT_EQ(deque.TrySteal(), 7);
+  EXPECT_FALSE(deque.TryPop().has_value());
+}
+
+TEST(ChaseLevDeque, EveryItemTakenExactlyOnce) {
+  constexpr int kItems = 200000;
+  constexpr int kThieves = 3;
+  ChaseLevDeque<int> deque(4);
+  std::vector<std::atomic<int>> taken(kItems);
+  std::atomic<int> total{0};
+  std::atomic<bool> done{false};
+
+  std::vector<std::thread> thieves;
+  for (int i = 0; i < kThieves; i++) {
+    thieves.emplace_back([&] {
+      while (!done || !deque.Empty()) {
+        if (auto value = deque.TrySteal()) {
+          taken[*value].fetch_add(1);
+          total.fetch_add(1);
+        }
+      }
+    });
+  }
+
+  // 所属线程交替压入与弹出，与窃取者在最后一个元素上竞争
+  for (int i = 0; i < kItems; i++) {
+    deque.Push(i);
+    if (i % 3 == 0) {
+      if (auto value = deque.TryPop()) {
+        taken[*value].fetch_add(1);
+        total.fetch_add(1);
+      }
+    }
+  }
+  while (auto value = deque.TryPop()) {
+    taken[*value].fetch_add(1);
+    total.fetch_add(1);
+  }
+  done = true;
+  for (auto& thief : thieves) thief.join();
+
+  EXPECT_EQ(total.load(), kItems);
+  for (int i = 0; i < kItems; i++) {
+    ASSERT_EQ(taken[i].load(), 1) << "item " << i;
+  }
+}
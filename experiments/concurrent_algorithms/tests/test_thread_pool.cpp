@@ -0,0 +1,195 @@
+#include "concurrent/thread_pool.hpp"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <ctime>
+#include <future>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+using playground::experiments::parallel::FunctionWrapper;
+using playground::experiments::parallel::ParallelInvoke;
+using playground::experiments::parallel::ThreadPool;
+using playground::experiments::parallel::WorkStealingQueue;
+
+TEST(ExperimentalThreadPool, IdleWorkersPark) {
+  ThreadPool pool(4);
+  EXPECT_EQ(pool.AddTask([] { return 1; }).get(), 1);
+
+  // 自旋结束后线程全部休眠，进程几乎不再消耗 CPU
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  const std::clock_t start = std::clock();
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+  const double cpu_ms =
+      1000.0 * static_cast<double>(std::clock() - start) / CLOCKS_PER_SEC;
+  EXPECT_LT(cpu_ms, 50.0);
+
+  // 休眠的线程能被新任务唤醒
+  std::vector<std::future<int>> futures;
+  for (int i = 0; i < 1000; i++) {
+    futures.push_back(pool.AddTask([i] { return i; }));
+  }
+  for (int i = 0; i < 1000; i++) EXPECT_EQ(futures[i].get(), i);
+}
+
+TEST(ExperimentalThreadPool, WakesParkedWorkersRepeatedly) {
+  ThreadPool pool(2);
+  for (int round = 0; round < 20; round++) {
+    EXPECT_EQ(pool.AddTask([round] { return round; }).get(), round);
+    // 等到线程用完自旋次数进入休眠
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+  }
+}
+
+TEST(ExperimentalThreadPool, WorkersPushOnlyToTheirOwnPool) {
+  ThreadPool outer(1);
+  ThreadPool inner(1);
+  // 单线程的 outer 阻塞等待 inner 的任务：若任务误入 outer 的本地队列将永远等不到
+  auto fut = outer.AddTask([&inner] {
+    auto nested = inner.AddTask([] { return std::this_thread::get_id(); });
+    if (nested.wait_for(std::chrono::seconds(5)) !=
+        std::future_status::ready) {
+      return false;
+    }
+    return nested.get() != std::this_thread::get_id();
+  });
+  EXPECT_TRUE(fut.get());
+  EXPECT_EQ(inner.GetStats().local_pushes[0], 0u);
+  EXPECT_EQ(outer.GetStats().local_pushes[0], 0u);
+}
+
+TEST(ExperimentalThreadPool, NestedPoolInsideTask) {
+  ThreadPool outer(2);
+  auto fut = outer.AddTask([] {
+    ThreadPool inner(2);
+    auto root = inner.AddTask([&inner] {
+      std::vector<std::future<int>> children;
+      for (int i = 0; i < 100; i++) {
+        children.push_back(inner.AddTask([i] { return i; }));
+      }
+      int sum = 0;
+      for (auto& child : children) {
+        while (child.wait_for(std::chrono::seconds(0)) !=
+               std::future_status::ready) {
+          inner.RunPendingTasks();
+        }
+        sum += child.get();
+      }
+      return sum;
+    });
+    const int sum = root.get();
+    // 子任务由 inner 的工作线程提交，全部进入它自己的本地队列
+    const auto pushes = inner.GetStats().local_pushes;
+    return sum == 4950 && pushes[0] + pushes[1] == 100;
+  });
+  EXPECT_TRUE(fut.get());
+  EXPECT_EQ(outer.ThreadCount(), 2u);
+}
+
+TEST(ExperimentalThreadPool, StealHalfMovesBatchToThief) {
+  WorkStealingQueue victim;
+  WorkStealingQueue thief;
+  std::vector<int> order;
+  for (int i = 0; i < 10; i++) {
+    victim.Push(FunctionWrapper([&order, i] { order.push_back(i); }));
+  }
+
+  FunctionWrapper task;
+  EXPECT_EQ(victim.StealHalf(task, &thief), 5u);
+  EXPECT_EQ(victim.Size(), 5u);
+  EXPECT_EQ(thief.Size(), 4u);
+  // 取到的是最早压入的任务
+  task();
+  EXPECT_EQ(order, std::vector<int>{0});
+
+  // 没有本地队列时只取一个
+  EXPECT_EQ(victim.StealHalf(task, nullptr), 1u);
+  EXPECT_EQ(victim.Size(), 4u);
+
+  WorkStealingQueue empty;
+  EXPECT_EQ(empty.StealHalf(task, &thief), 0u);
+}
+
+TEST(ExperimentalThreadPool, StealCountersAreConsistent) {
+  ThreadPool pool(4);
+  std::vector<std::future<int>> roots;
+  for (int r = 0; r < 8; r++) {
+    roots.push_back(pool.AddTask([&pool] {
+      std::vector<std::future<int>> children;
+      for (int c = 0; c < 200; c++) {
+        children.push_back(pool.AddTask([c] { return c; }));
+      }
+      int sum = 0;
+      for (auto& child : children) {
+        while (child.wait_for(std::chrono::seconds(0)) !=
+               std::future_status::ready) {
+          pool.RunPendingTasks();
+        }
+        sum += child.get();
+      }
+      return sum;
+    }));
+  }
+  for (auto& root : roots) EXPECT_EQ(root.get(), 19900);
+
+  const ThreadPool::Stats stats = pool.GetStats();
+  ASSERT_EQ(stats.steal_attempts.size(), 4u);
+  for (unsigned i = 0; i < 4; i++) {
+    EXPECT_LE(stats.steals[i], stats.steal_attempts[i]);
+    EXPECT_GE(stats.stolen_tasks[i], stats.steals[i]);
+  }
+  EXPECT_LE(stats.external_steals, stats.external_steal_attempts);
+}
+
+namespace {
+long Fib(ThreadPool& pool, int n) {
+  if (n < 2) return n;
+  if (n < 12) return Fib(pool, n - 1) + Fib(pool, n - 2);
+  long a = 0;
+  long b = 0;
+  ParallelInvoke(
+      pool, [&] { a = Fib(pool, n - 1); }, [&] { b = Fib(pool, n - 2); });
+  return a + b;
+}
+}  // namespace
+
+TEST(ExperimentalThreadPool, ParallelInvokeRecursion) {
+  ThreadPool pool(2);
+  EXPECT_EQ(Fib(pool, 25), 75025);
+  // 工作线程内部也能嵌套调用
+  EXPECT_EQ(pool.AddTask([&pool] { return Fib(pool, 20); }).get(), 6765);
+}
+
+TEST(ExperimentalThreadPool, ParallelInvokePropagatesExceptions) {
+  ThreadPool pool(2);
+  std::atomic<bool> g_done{false};
+  EXPECT_THROW(ParallelInvoke(
+                   pool, [] { throw std::runtime_error("f"); },
+                   [&g_done] {
+                     std::this_thread::sleep_for(std::chrono::milliseconds(5));
+                     g_done = true;
+                   }),
+               std::runtime_error);
+  // f 抛出时仍等到 g 结束
+  EXPECT_TRUE(g_done.load());
+
+  EXPECT_THROW(
+      ParallelInvoke(pool, [] {}, [] { throw std::logic_error("g"); }),
+      std::logic_error);
+}
+
+TEST(ExperimentalThreadPool, JoinHandleReturnsResult) {
+  ThreadPool pool(1);
+  auto handle = pool.Spawn([] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    return 42;
+  });
+  EXPECT_TRUE(handle.Valid());
+  EXPECT_EQ(handle.Join(), 42);
+  EXPECT_TRUE(handle.Ready());
+
+  auto failed = pool.Spawn([]() -> int { throw std::runtime_error("x"); });
+  EXPECT_THROW(failed.Join(), std::runtime_error);
+}
@@ -0,0 +1,59 @@
+// 在 ThreadPool 上调度协程：模拟异步请求处理。
+// 每个请求的处理函数 co_await pool.schedule() 切到工作线程，
+// 再 co_await 一次“后端调用”（同样提交到池中的任务）。等待后端期间协程挂起，
+// 不占用工作线程，所以 2 个线程就能同时推进成百上千个请求。
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "playground/threading/coro_task.hpp"
+#include "playground/threading/thread_pool.h"
+
+namespace {
+using playground::Task;
+using playground::TaskFuture;
+using playground::ThreadPool;
+
+// 模拟后端服务：耗时的计算放在池中普通任务里执行
+TaskFuture<int> queryBackend(ThreadPool& pool, int key) {
+  return pool.addTask([key] {
+    std::this_thread::sleep_for(std::chrono::microseconds(200));
+    return key * key;
+  });
+}
+
+Task<int> parseRequest(int id) { co_return id % 97; }
+
+Task<std::string> handleRequest(ThreadPool& pool, int id) {
+  co_await pool.schedule();
+  const int key = co_await parseRequest(id);
+  // 挂起期间工作线程可以去处理其他请求
+  const int value = co_await queryBackend(pool, key);
+  co_return "request " + std::to_string(id) + ": " + std::to_string(value);
+}
+}  // namespace
+
+int main() {
+  constexpr int kRequests = 1000;
+  ThreadPool pool(2);
+
+  const auto start = std::chrono::steady_clock::now();
+  std::vector<TaskFuture<std::string>> responses;
+  responses.reserve(kRequests);
+  for (int id = 0; id < kRequests; id++) {
+    responses.push_back(playground::spawn(pool, handleRequest(pool, id)));
+  }
+  std::string last;
+  for (auto& response : responses) last = response.get();
+  const auto elapsed = std::chrono::steady_clock::now() - start;
+
+  std::cout << last << "\n"
+            << kRequests << " requests on " << pool.threadCount()
+            << " threads in "
+            << std::chrono::duration_cast<std::chrono::milliseconds>(elapsed)
+                   .count()
+            << " ms" << std::endl;
+  return 0;
+}
@@ -1,12 +1,20 @@
 #pragma once
+#include <stdarg.h>
 #include <stdio.h>
 
+#include <atomic>
+#include <chrono>
 #include <condition_variable>
-#include <list>
+#include <cstdint>
 #include <memory>
 #include <mutex>
 #include <string>
 #include <thread>
+#include <vector>
+
+#include "playground/threading/log_format.hpp"
+#include "playground/threading/log_record.h"
+#include "playground/threading/mapped_log_file.h"
 
 namespace playground {
 // #ifdef LOG_EXPORTS
@@ -28,23 +36,45 @@ enum LOG_LEVEL {
   LOG_LEVEL_CRITICAL   // CRITICAL 日志不受日志级别控制，总是输出
 };
 
+// 日志文件的刷新策略，数值参数见 CAsyncLog::setFlushPolicy
+enum LOG_FLUSH_POLICY {
+  LOG_FLUSH_EVERY_LINE,  // 每写出一批日志都刷新（默认）
+  LOG_FLUSH_INTERVAL,    // 距上次刷新超过 N 毫秒时刷新
+  LOG_FLUSH_BYTES        // 未刷新的数据超过 N KB 时刷新
+};
+
+// 线程的日志缓冲区满时（写线程跟不上，例如磁盘卡顿）如何处理新日志。
+// CRITICAL 日志总是等待，不会被丢弃；FATAL 日志同步写出，不经过缓冲区
+enum LOG_QUEUE_POLICY {
+  LOG_QUEUE_BLOCK,        // 等写线程腾出空间（默认）
+  LOG_QUEUE_DROP_NEWEST,  // 丢弃新的日志
+  LOG_QUEUE_DROP_OLDEST,  // 丢弃缓冲区中最早的日志
+  LOG_QUEUE_SAMPLE        // 超过 3/4 满后每 N 条保留一条，满时丢弃新的日志
+};
+
+// 低于这个级别的日志调用在编译期去掉，参数也不会求值，FATAL 和 CRITICAL
+// 不受影响。可以在编译选项中指定，例如 -DPLAYGROUND_LOG_MIN_LEVEL=2
+#ifndef PLAYGROUND_LOG_MIN_LEVEL
+#define PLAYGROUND_LOG_MIN_LEVEL LOG_LEVEL_TRACE
+#endif
+#define PLAYGROUND_LOG_ENABLED(nLevel)                                    \
+  ((nLevel) >= PLAYGROUND_LOG_MIN_LEVEL || (nLevel) == LOG_LEVEL_FATAL || \
+   (nLevel) == LOG_LEVEL_CRITICAL)
+
 // TODO: 多增加几个策略
 // 注意：如果打印的日志信息中有中文，则格式化字符串要用_T()宏包裹起来，
 // e.g. LOGI(_T("GroupID=%u, GroupName=%s, GroupName=%s."),
 // lpGroupInfo->m_nGroupCode, lpGroupInfo->m_strAccount.c_str(),
 // lpGroupInfo->m_strName.c_str());
-#define LOGT(...) \
-  CAsyncLog::output(LOG_LEVEL_TRACE, __FILE__, __LINE__, __VA_ARGS__)
-#define LOGD(...) \
-  CAsyncLog::output(LOG_LEVEL_DEBUG, __FILE__, __LINE__, __VA_ARGS__)
-#define LOGI(...) \
-  CAsyncLog::output(LOG_LEVEL_INFO, __FILE__, __LINE__, __VA_ARGS__)
-#define LOGW(...) \
-  CAsyncLog::output(LOG_LEVEL_WARNING, __FILE__, __LINE__, __VA_ARGS__)
-#define LOGE(...) \
-  CAsyncLog::output(LOG_LEVEL_ERROR, __FILE__, __LINE__, __VA_ARGS__)
-#define LOGSYSE(...) \
-  CAsyncLog::output(LOG_LEVEL_SYSERROR, __FILE__, __LINE__, __VA_ARGS__)
+#define LOG_OUTPUT(nLevel, ...)        \
+  (PLAYGROUND_LOG_ENABLED(nLevel) && \
+   CAsyncLog::output(nLevel, __FILE__, __LINE__, __VA_ARGS__))
+#define LOGT(...) LOG_OUTPUT(LOG_LEVEL_TRACE, __VA_ARGS__)
+#define LOGD(...) LOG_OUTPUT(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#define LOGI(...) LOG_OUTPUT(LOG_LEVEL_INFO, __VA_ARGS__)
+#define LOGW(...) LOG_OUTPUT(LOG_LEVEL_WARNING, __VA_ARGS__)
+#define LOGE(...) LOG_OUTPUT(LOG_LEVEL_ERROR, __VA_ARGS__)
+#define LOGSYSE(...) LOG_OUTPUT(LOG_LEVEL_SYSERROR, __VA_ARGS__)
 #define LOGF(...)                          \
   CAsyncLog::output(                       \
       LOG_LEVEL_FATAL, __FILE__, __LINE__, \
@@ -56,6 +86,46 @@ enum LOG_LEVEL {
 // 用于输出数据包的二进制格式
 #define LOG_DEBUG_BIN(buf, buflength) CAsyncLog::outputBinary(buf, buflength)
 
+// std::format 风格的日志，例如 FLOGI("x={} y={}", x, y)。格式串在编译期校验，
+// 消息只格式化一次，写入线程局部的缓冲区，见 log_format.hpp
+#define LOG_FORMAT(nLevel, ...)                                         \
+  do {                                                                  \
+    if constexpr (PLAYGROUND_LOG_ENABLED(nLevel)) {                     \
+      CAsyncLog::outputFormat(nLevel, __FILE__, __LINE__, __VA_ARGS__); \
+    }                                                                   \
+  } while (0)
+#define FLOGT(...) LOG_FORMAT(LOG_LEVEL_TRACE, __VA_ARGS__)
+#define FLOGD(...) LOG_FORMAT(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#define FLOGI(...) LOG_FORMAT(LOG_LEVEL_INFO, __VA_ARGS__)
+#define FLOGW(...) LOG_FORMAT(LOG_LEVEL_WARNING, __VA_ARGS__)
+#define FLOGE(...) LOG_FORMAT(LOG_LEVEL_ERROR, __VA_ARGS__)
+#define FLOGSYSE(...) LOG_FORMAT(LOG_LEVEL_SYSERROR, __VA_ARGS__)
+#define FLOGF(...) LOG_FORMAT(LOG_LEVEL_FATAL, __VA_ARGS__)
+#define FLOGC(...) LOG_FORMAT(LOG_LEVEL_CRITICAL, __VA_ARGS__)
+
+// 延迟格式化的日志：调用处只复制参数的原始字节，由写线程或 log_decoder
+// 生成文本，见 log_record.h。格式串必须是字符串字面量，参数只能是整数、
+// 浮点数、指针和 C 字符串（字符串会被复制），编译器照常检查格式串
+#define LOG_DEFERRED(nLevel, pszFmt, ...)                                   \
+  do {                                                                      \
+    if constexpr (PLAYGROUND_LOG_ENABLED(nLevel)) {                         \
+      if (false) checkLogFormat(pszFmt __VA_OPT__(, ) __VA_ARGS__);         \
+      static const LogFormatInfo s_logFormatInfo{nLevel, __FILE__,          \
+                                                 __LINE__, pszFmt};         \
+      static const uint32_t s_nLogFormatId =                                \
+          CAsyncLog::registerFormat(&s_logFormatInfo);                      \
+      CAsyncLog::outputDeferred(nLevel, s_nLogFormatId __VA_OPT__(, )       \
+                                            __VA_ARGS__);                   \
+    }                                                                       \
+  } while (0)
+#define DLOGT(...) LOG_DEFERRED(LOG_LEVEL_TRACE, __VA_ARGS__)
+#define DLOGD(...) LOG_DEFERRED(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#define DLOGI(...) LOG_DEFERRED(LOG_LEVEL_INFO, __VA_ARGS__)
+#define DLOGW(...) LOG_DEFERRED(LOG_LEVEL_WARNING, __VA_ARGS__)
+#define DLOGE(...) LOG_DEFERRED(LOG_LEVEL_ERROR, __VA_ARGS__)
+#define DLOGSYSE(...) LOG_DEFERRED(LOG_LEVEL_SYSERROR, __VA_ARGS__)
+#define DLOGC(...) LOG_DEFERRED(LOG_LEVEL_CRITICAL, __VA_ARGS__)
+
 class LOG_API CAsyncLog {
  public:
   static bool init(const char* pszLogFileName = nullptr,
@@ -65,6 +135,26 @@ class LOG_API CAsyncLog {
 
   static void setLevel(LOG_LEVEL nLevel);
   static bool isRunning();
+  // 以下设置在 init 之前调用
+  // 是否把日志输出到控制台，默认输出
+  static void setConsoleEcho(bool bEcho);
+  // nValue 对 LOG_FLUSH_INTERVAL 是毫秒数，对 LOG_FLUSH_BYTES 是 KB 数
+  static void setFlushPolicy(LOG_FLUSH_POLICY nPolicy, int64_t nValue = 0);
+  // 日志文件改为二进制格式，延迟日志不再格式化，用 log_decoder 还原成文本
+  static void setBinaryFile(bool bBinary);
+  // 日志文件预分配 rollsize 大小并映射到内存，写线程直接复制进去，
+  // 下一个文件提前建好，轮转时只需改名。数据写入即对其他进程可见，
+  // 刷新策略不再起作用。映射失败时退回普通文件
+  static void setMappedFile(bool bMapped);
+  // 每个线程的日志缓冲区最多容纳的行数，向上取整到 2 的幂，默认 4096。
+  // 限制的是行数而不是字节数，很长的行仍可能占用大量内存。
+  // 只对之后第一次输出日志的线程生效
+  static void setQueueCapacity(size_t nLines);
+  // 缓冲区满时的处理方式，nValue 对 LOG_QUEUE_SAMPLE 是采样间隔 N
+  static void setQueuePolicy(LOG_QUEUE_POLICY nPolicy, int64_t nValue = 0);
+
+  // 进程启动以来因缓冲区满而丢弃的日志行数。有丢弃时写线程会输出一行汇总
+  static uint64_t droppedLines(LOG_LEVEL nLevel);
 
   // 不输出线程ID号和所在函数签名、行号
   static bool output(long nLevel, const char* pszFmt, ...);
@@ -74,6 +164,17 @@ class LOG_API CAsyncLog {
 
   static bool outputBinary(unsigned char* buffer, size_t size);
 
+  // 供 LOG_FORMAT 使用
+  template <typename... Args>
+  static bool outputFormat(long nLevel, const char* pszFileName, int nLineNo,
+                           LogFormatString<Args...> fmt, Args&&... args);
+
+  // 供 LOG_DEFERRED 使用：登记调用点，返回格式编号
+  static uint32_t registerFormat(const LogFormatInfo* pInfo);
+  template <typename... Args>
+  static bool outputDeferred(long nLevel, uint32_t nFormatId,
+                             const Args&... args);
+
  private:
   CAsyncLog() = delete;
   ~CAsyncLog() = delete;
@@ -83,9 +184,27 @@ class LOG_API CAsyncLog {
 
   // [日志级别][时间][线程号]
   static void makeLinePrefix(long nLevel, std::string& strPrefix);
-  static void getTime(char* pszTime, int nTimeStrLength);
+  // 当前线程复用的行缓冲区
+  static std::string& lineBuffer();
+  // 把 printf 风格的正文追加到 strLine 末尾
+  static void appendFormat(std::string& strLine, const char* pszFmt,
+                           va_list ap);
+  // 输出一行已格式化的日志，nMessageBegin 是正文的起始位置（用于截断）。
+  // FATAL 日志同步写出后让程序崩溃，其余交给写线程
+  static bool outputLine(long nLevel, std::string& strLine,
+                         size_t nMessageBegin);
   static bool createNewFile(const char* pszLogFileName);
+  static bool hasLogFile();
+  // 当前映射文件写过一半后提前建好下一个文件
+  static void prepareNextFile();
+  // 第一次写入或文件超过 rollsize 时新建日志文件
+  static bool rollFileIfNeeded();
   static bool writeToFile(const std::string& data);
+  // 写线程把一批日志一次写出到控制台和文件，然后清空 strBatch
+  // 二进制文件模式下写入文件的是 strBinary
+  static bool writeBatch(std::string& strBatch, std::string& strBinary);
+  // 按刷新策略刷新日志文件，bForce 为 true 时总是刷新
+  static void flushFile(bool bForce);
   // 让程序主动崩溃
   static void crash();
 
@@ -95,6 +214,31 @@ class LOG_API CAsyncLog {
 
   static void writeThreadProc();
 
+  // 每个生产者线程一个的单生产者单消费者环形缓冲，定义见 async_log.cpp
+  class ThreadBuffer;
+  struct PendingLine;
+
+  // 把一行日志放入当前线程的缓冲区，热路径上不加锁
+  static void enqueue(long nLevel, const std::string& strLine);
+  static ThreadBuffer& localBuffer();
+  // 写线程休眠时唤醒它
+  static void notifyWriter();
+  // 在当前线程的缓冲区中预留一条记录，返回参数区的起始位置；
+  // 写线程没有运行且缓冲区已满时返回 nullptr
+  // 按缓冲区策略丢弃时同样返回 nullptr
+  static char* beginRecord(long nLevel, uint32_t nFormatId, size_t nArgsSize);
+  static void commitRecord();
+  // 写线程调用，查找格式编号对应的调用点
+  static const LogFormatInfo* lookupFormat(uint32_t nFormatId);
+  // 写线程调用，把一条日志按输出方式追加到文本或二进制批次中
+  static void appendPendingLine(const PendingLine& line, std::string& strBatch,
+                                std::string& strBinary);
+  static void countDroppedLine(long nLevel);
+  // 写线程调用，上次汇总之后有日志被丢弃时追加一行汇总
+  static void appendDropSummary(std::string& strBatch, std::string& strBinary);
+  // 取出所有缓冲区中已有的日志，按时间戳合并，返回是否取到
+  static bool collectLines(std::vector<PendingLine>& lines);
+
  private:
   static bool m_bToFile;  // 日志写入文件还是写到控制台
   static FILE* m_hLogFile;
@@ -104,11 +248,73 @@ class LOG_API CAsyncLog {
   static LOG_LEVEL m_nCurrentLevel;                  // 当前日志级别
   static int64_t m_nFileRollSize;                    // 单个日志文件的最大字节数
   static int64_t m_nCurrentWrittenSize;              // 已经写入的字节数目
-  static std::list<std::string> m_listLinesToWrite;  // 待写入的日志
+  static bool m_bConsoleEcho;                        // 是否输出到控制台
+  static LOG_FLUSH_POLICY m_nFlushPolicy;            // 文件刷新策略
+  static int64_t m_nFlushValue;                      // 刷新策略的参数
+  static int64_t m_nUnflushedSize;                   // 尚未刷新的字节数
+  static std::chrono::steady_clock::time_point m_tpLastFlush;  // 上次刷新
+  static bool m_bBinaryFile;                         // 二进制日志文件
+  static bool m_bMappedFile;                         // 使用内存映射文件
+  static MappedLogFile m_mappedFile;                 // 当前的映射文件
+  static MappedLogFile m_nextMappedFile;             // 提前建好的下一个文件
+  static size_t m_nQueueCapacity;                    // 每个线程缓冲区的行数
+  static LOG_QUEUE_POLICY m_nQueuePolicy;            // 缓冲区满时的策略
+  static int64_t m_nQueueValue;                      // 缓冲区策略的参数
+  // 按级别统计的丢弃行数，以及写线程已经汇总过的部分
+  static std::atomic<uint64_t> m_nDroppedLines[LOG_LEVEL_CRITICAL + 1];
+  static uint64_t m_nReportedDrops[LOG_LEVEL_CRITICAL + 1];
+
+  static std::vector<const LogFormatInfo*> m_vecFormats;  // 按格式编号索引
+  static std::mutex m_mutexFormats;  // 只保护 m_vecFormats
+  // 以下只由写线程访问：m_vecFormats 的副本，以及当前文件已写入的格式
+  static std::vector<const LogFormatInfo*> m_vecFormatCache;
+  static std::vector<bool> m_vecFormatInFile;
+  // 新线程注册的缓冲区，写线程每轮把它们接管到自己的列表中
+  static std::vector<std::shared_ptr<ThreadBuffer>> m_vecNewBuffers;
+  static std::mutex m_mutexBuffers;  // 只保护 m_vecNewBuffers
+  // 写线程已接管的缓冲区，只由写线程访问，重新 init 后继续使用
+  static std::vector<std::shared_ptr<ThreadBuffer>> m_vecBuffers;
   static std::unique_ptr<std::thread> m_spWriteThread;
-  static std::mutex m_mutexWrite;
+  static std::mutex m_mutexWrite;  // 配合 m_cvWrite 让写线程休眠
+  // 串行化写线程与同步写出的 FATAL 日志对日志文件（含映射区域）的访问
+  static std::mutex m_mutexFile;
   static std::condition_variable m_cvWrite;
-  static bool m_bExit;     // 退出标志
-  static bool m_bRunning;  // 运行标志
+  static std::atomic<bool> m_bWriterSleeping;  // 写线程是否准备休眠
+  static std::atomic<bool> m_bExit;            // 退出标志
+  static std::atomic<bool> m_bRunning;         // 运行标志
 };
+
+template <typename... Args>
+bool CAsyncLog::outputDeferred(long nLevel, uint32_t nFormatId,
+                               const Args&... args) {
+  if (nLevel != LOG_LEVEL_CRITICAL) {
+    if (nLevel < m_nCurrentLevel) return false;
+  }
+
+  const size_t nArgsSize = (size_t{0} + ... + encodedLogArgSize(args));
+  char* p = beginRecord(nLevel, nFormatId, nArgsSize);
+  if (p == nullptr) return false;
+  ((p = encodeLogArg(p, args)), ...);
+  commitRecord();
+  return true;
+}
+
+template <typename... Args>
+bool CAsyncLog::outputFormat(long nLevel, const char* pszFileName, int nLineNo,
+                             LogFormatString<Args...> fmt, Args&&... args) {
+  if (nLevel != LOG_LEVEL_CRITICAL) {
+    if (nLevel < m_nCurrentLevel) return false;
+  }
+
+  std::string& strLine = lineBuffer();
+  makeLinePrefix(nLevel, strLine);
+  strLine += '[';
+  strLine += pszFileName;
+  strLine += ':';
+  strLine += std::to_string(nLineNo);
+  strLine += ']';
+  const size_t nMessageBegin = strLine.size();
+  formatLogMessage(strLine, fmt, std::forward<Args>(args)...);
+  return outputLine(nLevel, strLine, nMessageBegin);
+}
 }  // namespace playground
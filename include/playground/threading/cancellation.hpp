@@ -0,0 +1,45 @@
+#ifndef PLAYGROUND_THREADING_CANCELLATION_H_
+#define PLAYGROUND_THREADING_CANCELLATION_H_
+#include <atomic>
+#include <memory>
+#include <stdexcept>
+
+namespace playground {
+// 任务在开始前被取消时，其 future 得到的异常
+class TaskCancelled : public std::runtime_error {
+ public:
+  TaskCancelled() : std::runtime_error("Task was cancelled!") {}
+};
+
+// 只读的取消标志，随任务一起提交。默认构造的令牌永远不会被取消
+class CancellationToken {
+ public:
+  CancellationToken() = default;
+
+  bool cancelled() const {
+    return state_ && state_->load(std::memory_order_acquire);
+  }
+
+ private:
+  friend class CancellationSource;
+  explicit CancellationToken(std::shared_ptr<const std::atomic<bool>> state)
+      : state_(std::move(state)) {}
+
+  std::shared_ptr<const std::atomic<bool>> state_;
+};
+
+// 发出取消请求的一方，可以派生任意多个共享同一标志的令牌
+class CancellationSource {
+ public:
+  CancellationSource() : state_(std::make_shared<std::atomic<bool>>(false)) {}
+
+  CancellationToken token() const { return CancellationToken(state_); }
+  // 只影响尚未开始的任务；已在运行的任务可自行轮询令牌提前结束
+  void cancel() { state_->store(true, std::memory_order_release); }
+  bool cancelled() const { return state_->load(std::memory_order_acquire); }
+
+ private:
+  std::shared_ptr<std::atomic<bool>> state_;
+};
+}  // namespace playground
+#endif
@@ -0,0 +1,235 @@
+#ifndef PLAYGROUND_THREADING_CORO_TASK_H_
+#define PLAYGROUND_THREADING_CORO_TASK_H_
+#include <coroutine>
+#include <exception>
+#include <memory>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+#include "playground/threading/task_future.h"
+#include "playground/threading/thread_pool.h"
+
+namespace playground {
+template <typename T = void>
+class Task;
+
+namespace detail {
+// Task 的 promise 公共部分：保存等待者与异常，结束时直接切换回等待者
+class TaskPromiseBase {
+ public:
+  struct FinalAwaiter {
+    bool await_ready() const noexcept { return false; }
+    template <typename Promise>
+    std::coroutine_handle<> await_suspend(
+        std::coroutine_handle<Promise> handle) noexcept {
+      std::coroutine_handle<> next = handle.promise().continuation_;
+      return next ? next : std::noop_coroutine();
+    }
+    void await_resume() const noexcept {}
+  };
+
+  std::suspend_always initial_suspend() const noexcept { return {}; }
+  FinalAwaiter final_suspend() const noexcept { return {}; }
+  void unhandled_exception() noexcept { error_ = std::current_exception(); }
+
+  void setContinuation(std::coroutine_handle<> handle) noexcept {
+    continuation_ = handle;
+  }
+
+ protected:
+  void rethrowIfFailed() const {
+    if (error_) std::rethrow_exception(error_);
+  }
+
+ private:
+  std::coroutine_handle<> continuation_;
+  std::exception_ptr error_;
+};
+
+template <typename T>
+class TaskPromiseImpl : public TaskPromiseBase {
+ public:
+  Task<T> get_return_object() noexcept;
+
+  template <typename V>
+  void return_value(V&& value) {
+    value_.emplace(std::forward<V>(value));
+  }
+  T result() {
+    rethrowIfFailed();
+    return std::move(*value_);
+  }
+
+ private:
+  std::optional<T> value_;
+};
+
+template <>
+class TaskPromiseImpl<void> : public TaskPromiseBase {
+ public:
+  Task<void> get_return_object() noexcept;
+
+  void return_void() const noexcept {}
+  void result() { rethrowIfFailed(); }
+};
+
+// spawn() 启动时的调度：投递的恢复任务拥有尚未开始的协程帧。
+// 任务被丢弃而没有执行（abort()、drainFor() 超时）时销毁整个协程帧，
+// 其中的 TaskPromise 随之析构，future 得到 broken_promise
+class SpawnAwaiter {
+ public:
+  explicit SpawnAwaiter(ThreadPool& pool) : pool_(pool) {}
+
+  bool await_ready() const noexcept { return false; }
+  void await_suspend(std::coroutine_handle<> handle) {
+    auto frame = std::make_shared<OwnedFrame>(handle);
+    try {
+      pool_.execute([frame] { std::exchange(frame->handle, {}).resume(); });
+    } catch (...) {
+      // 提交失败：协程帧仍归协程自己，异常从 co_await 处抛出
+      frame->handle = {};
+      throw;
+    }
+    // 之后不能再访问本对象：协程可能已在其他线程恢复甚至结束
+  }
+  void await_resume() const noexcept {}
+
+ private:
+  struct OwnedFrame {
+    explicit OwnedFrame(std::coroutine_handle<> h) : handle(h) {}
+    ~OwnedFrame() {
+      if (handle) handle.destroy();
+    }
+    std::coroutine_handle<> handle;
+  };
+
+  ThreadPool& pool_;
+};
+
+// spawn() 使用的一次性协程：立即开始执行，结束时自行销毁
+struct DetachedTask {
+  struct promise_type {
+    DetachedTask get_return_object() const noexcept { return {}; }
+    std::suspend_never initial_suspend() const noexcept { return {}; }
+    std::suspend_never final_suspend() const noexcept { return {}; }
+    void return_void() const noexcept {}
+    void unhandled_exception() const noexcept { std::terminate(); }
+  };
+};
+}  // namespace detail
+
+// 惰性启动的协程任务：创建时不执行，被 co_await 时才在等待者所在线程开始，
+// 完成后由完成它的线程直接恢复等待者（对称转移，不额外占用线程）。
+// 要在线程池上独立运行，用 spawn(pool, task)
+template <typename T>
+class [[nodiscard]] Task {
+ public:
+  using promise_type = detail::TaskPromiseImpl<T>;
+  using Handle = std::coroutine_handle<promise_type>;
+
+  Task() = default;
+  Task(Task&& other) noexcept : handle_(std::exchange(other.handle_, {})) {}
+  Task& operator=(Task&& other) noexcept {
+    if (&other == this) {
+      return *this;
+    }
+    reset();
+    handle_ = std::exchange(other.handle_, {});
+    return *this;
+  }
+  Task(const Task&) = delete;
+  Task& operator=(const Task&) = delete;
+  ~Task() { reset(); }
+
+  bool valid() const { return static_cast<bool>(handle_); }
+
+  class Awaiter {
+   public:
+    bool await_ready() const noexcept { return !handle_ || handle_.done(); }
+    std::coroutine_handle<> await_suspend(
+        std::coroutine_handle<> awaiting) noexcept {
+      handle_.promise().setContinuation(awaiting);
+      return handle_;
+    }
+    T await_resume() {
+      if (!handle_) throw std::future_error(std::future_errc::no_state);
+      return handle_.promise().result();
+    }
+
+   private:
+    friend class Task;
+    explicit Awaiter(Handle handle) : handle_(handle) {}
+    Handle handle_;
+  };
+
+  // 每个 Task 只能被 co_await 一次，结果被移动给等待者
+  Awaiter operator co_await() & noexcept { return Awaiter(handle_); }
+  Awaiter operator co_await() && noexcept { return Awaiter(handle_); }
+
+ private:
+  friend class detail::TaskPromiseImpl<T>;
+  explicit Task(Handle handle) : handle_(handle) {}
+
+  void reset() {
+    if (handle_) {
+      std::exchange(handle_, {}).destroy();
+    }
+  }
+
+  Handle handle_;
+};
+
+namespace detail {
+template <typename T>
+Task<T> TaskPromiseImpl<T>::get_return_object() noexcept {
+  return Task<T>(Task<T>::Handle::from_promise(*this));
+}
+
+inline Task<void> TaskPromiseImpl<void>::get_return_object() noexcept {
+  return Task<void>(Task<void>::Handle::from_promise(*this));
+}
+}  // namespace detail
+
+// 在线程池上启动 task，返回供非协程代码等待的 future
+template <typename T>
+TaskFuture<T> spawn(ThreadPool& pool, Task<T> task) {
+  TaskPromise<T> promise(nullptr);
+  TaskFuture<T> future = promise.get_future();
+  // 参数按值保存在协程帧中，不捕获任何局部变量
+  [](ThreadPool& pool, Task<T> task,
+     TaskPromise<T> promise) -> detail::DetachedTask {
+    try {
+      co_await detail::SpawnAwaiter(pool);
+      if constexpr (std::is_void_v<T>) {
+        co_await std::move(task);
+        promise.set_value();
+      } else {
+        promise.set_value(co_await std::move(task));
+      }
+    } catch (...) {
+      promise.set_exception(std::current_exception());
+    }
+  }(pool, std::move(task), std::move(promise));
+  return future;
+}
+
+// co_await 一个 TaskFuture：挂起协程而不阻塞线程，
+// 结果就绪后在设置结果的线程上恢复
+template <typename R>
+auto operator co_await(TaskFuture<R>&& future) {
+  struct Awaiter {
+    TaskFuture<R> future;
+
+    bool await_ready() const { return future.ready(); }
+    void await_suspend(std::coroutine_handle<> handle) {
+      // 回调可能在 onReady 内部就恢复协程，之后不能再访问本对象
+      future.onReady([handle] { handle.resume(); });
+    }
+    R await_resume() { return future.get(); }
+  };
+  if (!future.valid()) throw std::future_error(std::future_errc::no_state);
+  return Awaiter{std::move(future)};
+}
+}  // namespace playground
+#endif
@@ -0,0 +1,28 @@
+#pragma once
+#include <string_view>
+#include <vector>
+
+namespace playground {
+// 本进程可用的 CPU，按 NUMA 节点分组。
+// 节点信息读自 /sys/devices/system/node，读不到时（非 Linux、容器内未挂载）
+// 所有可用 CPU 视为同一个节点
+struct CpuTopology {
+  // nodes[i] 为第 i 个节点上的 CPU 编号，升序；节点按 sysfs 编号升序压缩排列
+  std::vector<std::vector<unsigned int>> nodes;
+
+  static CpuTopology detect();
+
+  // cpu 所在节点的下标，不属于任何节点时返回 0
+  unsigned int nodeOf(unsigned int cpu) const;
+  size_t cpuCount() const;
+};
+
+// 解析内核的 cpulist 格式，例如 "0-3,8,10-11"；格式错误时返回已解析的部分
+std::vector<unsigned int> parseCpuList(std::string_view text);
+
+// 把当前线程绑定到指定 CPU，平台不支持或 CPU 不可用时返回 false
+bool pinCurrentThread(unsigned int cpu);
+
+// 当前线程正在运行的 CPU，无法获取时返回 -1
+int currentCpu();
+}  // namespace playground
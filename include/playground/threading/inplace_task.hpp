@@ -0,0 +1,97 @@
+#pragma once
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace playground {
+// 只能移动的 void() 可调用对象包装。
+// 与 std::function 不同，不要求可拷贝，且不超过 kInlineSize 的可调用对象
+// 直接构造在内部缓冲区中，不会触发堆分配；更大的对象才退回到 new。
+class InplaceTask {
+ public:
+  static constexpr std::size_t kInlineSize = 64;
+
+  InplaceTask() noexcept = default;
+
+  template <typename F, typename = std::enable_if_t<
+                            !std::is_same_v<std::decay_t<F>, InplaceTask>>>
+  InplaceTask(F&& f) {
+    using Fn = std::decay_t<F>;
+    if constexpr (kFitsInline<Fn>) {
+      ::new (static_cast<void*>(buffer_)) Fn(std::forward<F>(f));
+      ops_ = &kInlineOps<Fn>;
+    } else {
+      ::new (static_cast<void*>(buffer_)) Fn*(new Fn(std::forward<F>(f)));
+      ops_ = &kHeapOps<Fn>;
+    }
+  }
+
+  InplaceTask(InplaceTask&& other) noexcept { moveFrom(other); }
+  InplaceTask& operator=(InplaceTask&& other) noexcept {
+    if (&other == this) {
+      return *this;
+    }
+    reset();
+    moveFrom(other);
+    return *this;
+  }
+  InplaceTask(const InplaceTask&) = delete;
+  InplaceTask& operator=(const InplaceTask&) = delete;
+
+  ~InplaceTask() { reset(); }
+
+  explicit operator bool() const noexcept { return ops_ != nullptr; }
+
+  void operator()() { ops_->invoke(buffer_); }
+
+  void reset() noexcept {
+    if (ops_) {
+      ops_->destroy(buffer_);
+      ops_ = nullptr;
+    }
+  }
+
+ private:
+  struct Ops {
+    void (*invoke)(void* self);
+    // 把 from 中的对象移动构造到 to，并析构 from 中的对象
+    void (*relocate)(void* from, void* to) noexcept;
+    void (*destroy)(void* self) noexcept;
+  };
+
+  template <typename Fn>
+  static constexpr bool kFitsInline =
+      sizeof(Fn) <= kInlineSize &&
+      alignof(Fn) <= alignof(std::max_align_t) &&
+      std::is_nothrow_move_constructible_v<Fn>;
+
+  template <typename Fn>
+  static constexpr Ops kInlineOps = {
+      [](void* self) { (*static_cast<Fn*>(self))(); },
+      [](void* from, void* to) noexcept {
+        ::new (to) Fn(std::move(*static_cast<Fn*>(from)));
+        static_cast<Fn*>(from)->~Fn();
+      },
+      [](void* self) noexcept { static_cast<Fn*>(self)->~Fn(); }};
+
+  template <typename Fn>
+  static constexpr Ops kHeapOps = {
+      [](void* self) { (**static_cast<Fn**>(self))(); },
+      [](void* from, void* to) noexcept {
+        ::new (to) Fn*(*static_cast<Fn**>(from));
+      },
+      [](void* self) noexcept { delete *static_cast<Fn**>(self); }};
+
+  void moveFrom(InplaceTask& other) noexcept {
+    if (other.ops_) {
+      other.ops_->relocate(other.buffer_, buffer_);
+      ops_ = other.ops_;
+      other.ops_ = nullptr;
+    }
+  }
+
+  alignas(std::max_align_t) unsigned char buffer_[kInlineSize];
+  const Ops* ops_ = nullptr;
+};
+}  // namespace playground
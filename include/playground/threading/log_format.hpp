@@ -0,0 +1,135 @@
+#pragma once
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#if __has_include(<format>)
+#include <format>
+#endif
+
+// 标准库提供 std::format 时直接使用，格式串由 std::format_string 在编译期校验；
+// 否则退回到下面的简化实现：只支持 "{}"，同样在编译期检查参数个数
+#if defined(__cpp_lib_format) && __cpp_lib_format >= 202106L
+#define PLAYGROUND_LOG_STD_FORMAT 1
+#else
+#define PLAYGROUND_LOG_STD_FORMAT 0
+#endif
+
+namespace playground {
+#if PLAYGROUND_LOG_STD_FORMAT
+template <typename... Args>
+using LogFormatString = std::format_string<Args...>;
+
+template <typename... Args>
+void formatLogMessage(std::string& strOut, LogFormatString<Args...> fmt,
+                      Args&&... args) {
+  std::format_to(std::back_inserter(strOut), fmt, std::forward<Args>(args)...);
+}
+#else
+namespace log_format_detail {
+// 只声明不定义：在常量求值中调用它会让编译失败，报错中带有这个函数名
+void invalidLogFormatString(const char* pszReason);
+
+// "{{" 和 "}}" 表示花括号本身，"{}" 是一个替换字段
+consteval void checkLogFormat(std::string_view fmt, size_t nArgs) {
+  size_t nFields = 0;
+  for (size_t i = 0; i < fmt.size(); i++) {
+    const bool bPair = i + 1 < fmt.size() && fmt[i + 1] == fmt[i];
+    if (fmt[i] == '{') {
+      if (bPair || (i + 1 < fmt.size() && fmt[i + 1] == '}')) {
+        nFields += bPair ? 0 : 1;
+        i++;
+      } else {
+        invalidLogFormatString("only {} is supported without <format>");
+      }
+    } else if (fmt[i] == '}') {
+      if (!bPair) invalidLogFormatString("unmatched } in format string");
+      i++;
+    }
+  }
+  if (nFields != nArgs) {
+    invalidLogFormatString("format string does not match argument count");
+  }
+}
+
+template <typename... Args>
+class BasicLogFormatString {
+ public:
+  template <typename S>
+    requires std::is_convertible_v<const S&, std::string_view>
+  consteval BasicLogFormatString(const S& fmt) : m_fmt(fmt) {
+    checkLogFormat(m_fmt, sizeof...(Args));
+  }
+
+  std::string_view get() const { return m_fmt; }
+
+ private:
+  std::string_view m_fmt;
+};
+
+// 输出 fmt 中下一个替换字段之前的文本，并跳过这个字段
+inline void appendLogText(std::string& strOut, std::string_view& fmt) {
+  size_t i = 0;
+  while (i < fmt.size()) {
+    const char c = fmt[i];
+    if ((c == '{' || c == '}') && i + 1 < fmt.size() && fmt[i + 1] == c) {
+      strOut += c;
+      i += 2;
+    } else if (c == '{') {
+      fmt.remove_prefix(i + 2);
+      return;
+    } else {
+      strOut += c;
+      i++;
+    }
+  }
+  fmt.remove_prefix(i);
+}
+
+// 与 std::format 的 "{}" 输出一致
+template <typename T>
+void appendLogArg(std::string& strOut, const T& arg) {
+  using D = std::remove_cvref_t<T>;
+  char szBuf[128];
+  if constexpr (std::is_same_v<D, bool>) {
+    strOut += arg ? "true" : "false";
+  } else if constexpr (std::is_same_v<D, char>) {
+    strOut += arg;
+  } else if constexpr (std::is_arithmetic_v<D>) {
+    const auto result = std::to_chars(szBuf, szBuf + sizeof(szBuf), arg);
+    strOut.append(szBuf, result.ptr);
+  } else if constexpr (std::is_same_v<D, std::nullptr_t>) {
+    strOut += "0x0";
+  } else if constexpr (std::is_convertible_v<const D&, std::string_view>) {
+    strOut += std::string_view(arg);
+  } else if constexpr (std::is_same_v<D, void*> ||
+                       std::is_same_v<D, const void*>) {
+    const auto result = std::to_chars(szBuf, szBuf + sizeof(szBuf),
+                                      reinterpret_cast<uintptr_t>(arg), 16);
+    strOut += "0x";
+    strOut.append(szBuf, result.ptr);
+  } else {
+    static_assert(!std::is_same_v<D, D>, "type is not formattable");
+  }
+}
+}  // namespace log_format_detail
+
+template <typename... Args>
+using LogFormatString =
+    log_format_detail::BasicLogFormatString<std::type_identity_t<Args>...>;
+
+template <typename... Args>
+void formatLogMessage(std::string& strOut, LogFormatString<Args...> fmt,
+                      Args&&... args) {
+  std::string_view rest = fmt.get();
+  ((log_format_detail::appendLogText(strOut, rest),
+    log_format_detail::appendLogArg(strOut, args)),
+   ...);
+  log_format_detail::appendLogText(strOut, rest);
+}
+#endif
+}  // namespace playground
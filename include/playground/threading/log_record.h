@@ -0,0 +1,153 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+namespace playground {
+// 延迟格式化日志的编码。调用处只记录格式串编号和参数的原始字节，
+// 文本由写线程或离线工具 log_decoder 按格式串生成。
+//
+// 一条记录：u32 格式编号，u64 时间（微秒），u64 线程号，然后是各个参数。
+// 每个参数以 1 字节类型开头：整数、浮点数和指针占 8 字节，
+// 字符串是 u32 长度加内容（不含 \0）。整数按可变参数的规则提升，
+// 并记下原来是 32 位还是 64 位，%x 等转换的结果与 printf 相同。
+
+// 一个延迟日志调用点的静态信息，必须在整个程序运行期间有效
+struct LogFormatInfo {
+  long nLevel;
+  const char* pszFile;
+  int nLine;
+  const char* pszFmt;
+};
+
+enum LOG_ARG_TYPE : uint8_t {
+  LOG_ARG_INT32,
+  LOG_ARG_INT64,
+  LOG_ARG_UINT32,
+  LOG_ARG_UINT64,
+  LOG_ARG_DOUBLE,
+  LOG_ARG_POINTER,
+  LOG_ARG_STRING
+};
+
+constexpr size_t kLogRecordHeaderSize = 4 + 8 + 8;
+
+// 只用于让编译器检查格式串与参数是否匹配，从不调用
+#if defined(__GNUC__) || defined(__clang__)
+__attribute__((format(printf, 1, 2)))
+#endif
+inline void checkLogFormat(const char* /*pszFmt*/, ...) {}
+
+inline const char* logStringArg(const char* psz) {
+  return psz != nullptr ? psz : "(null)";
+}
+
+template <typename T>
+size_t encodedLogArgSize(const T& arg) {
+  using D = std::decay_t<T>;
+  if constexpr (std::is_same_v<D, const char*> || std::is_same_v<D, char*>) {
+    return 1 + 4 + strlen(logStringArg(arg));
+  } else {
+    return 1 + 8;
+  }
+}
+
+// 把参数写到 p，返回写完后的位置
+template <typename T>
+char* encodeLogArg(char* p, const T& arg) {
+  using D = std::decay_t<T>;
+  uint8_t nType;
+  uint64_t nBits = 0;
+  if constexpr (std::is_same_v<D, const char*> || std::is_same_v<D, char*>) {
+    const char* psz = logStringArg(arg);
+    const uint32_t nLength = static_cast<uint32_t>(strlen(psz));
+    *p++ = static_cast<char>(LOG_ARG_STRING);
+    memcpy(p, &nLength, 4);
+    memcpy(p + 4, psz, nLength);
+    return p + 4 + nLength;
+  } else if constexpr (std::is_pointer_v<D>) {
+    nType = LOG_ARG_POINTER;
+    nBits = reinterpret_cast<uintptr_t>(arg);
+  } else if constexpr (std::is_floating_point_v<D>) {
+    static_assert(sizeof(D) <= sizeof(double),
+                  "long double is not supported by deferred logging");
+    const double dValue = arg;
+    nType = LOG_ARG_DOUBLE;
+    memcpy(&nBits, &dValue, 8);
+  } else if constexpr (std::is_enum_v<D>) {
+    return encodeLogArg(p, static_cast<std::underlying_type_t<D>>(arg));
+  } else if constexpr (std::is_integral_v<D>) {
+    // 比 int 窄的整数和 int 一样按 32 位有符号数处理
+    constexpr bool bWide = sizeof(D) > 4;
+    if constexpr (std::is_signed_v<D> || sizeof(D) < sizeof(int)) {
+      nType = bWide ? LOG_ARG_INT64 : LOG_ARG_INT32;
+      nBits = static_cast<uint64_t>(static_cast<int64_t>(arg));
+    } else {
+      nType = bWide ? LOG_ARG_UINT64 : LOG_ARG_UINT32;
+      nBits = static_cast<uint64_t>(arg);
+    }
+  } else {
+    static_assert(std::is_integral_v<D>,
+                  "deferred logging only accepts printf-style arguments");
+  }
+  *p++ = static_cast<char>(nType);
+  memcpy(p, &nBits, 8);
+  return p + 8;
+}
+
+// 按 printf 格式串和编码后的参数生成日志正文，追加到 strOut。
+// 参数与转换说明不匹配时输出 "<?>"
+void formatLogArgs(const char* pszFmt, const char* pArgs, size_t nSize,
+                   std::string& strOut);
+
+// 级别标记，例如 "[INFO]"，未知的级别按 INFO 处理
+std::string_view logLevelTag(long nLevel);
+
+// [级别][时间][线程号]，时间为 Unix 时间（微秒），按本地时间输出到毫秒
+void appendLogPrefix(std::string& strOut, long nLevel, uint64_t nTimeUs,
+                     uint64_t nThreadId);
+
+// 把一条记录还原成一行完整的日志（不含换行符）
+void appendLogRecordText(std::string& strOut, const LogFormatInfo& info,
+                         const char* pRecord, size_t nSize);
+
+// 二进制日志文件由若干帧组成，每帧是 1 字节类型、u32 长度和内容：
+//   LOG_FRAME_FORMAT：u32 格式编号，i32 级别，i32 行号，文件名\0，格式串\0
+//   LOG_FRAME_RECORD：一条记录
+//   LOG_FRAME_TEXT：一行已经格式化好的日志
+// 每个文件都包含其中记录用到的所有格式，可以单独解码。
+enum LOG_FRAME_TYPE : uint8_t {
+  LOG_FRAME_FORMAT = 'F',
+  LOG_FRAME_RECORD = 'R',
+  LOG_FRAME_TEXT = 'T'
+};
+
+void appendLogFrame(std::string& strOut, LOG_FRAME_TYPE nType,
+                    const char* pData, size_t nSize);
+void appendLogFormatFrame(std::string& strOut, uint32_t nFormatId,
+                          const LogFormatInfo& info);
+
+// 把二进制日志还原成文本
+class LogDecoder {
+ public:
+  // 解码 [pData, pData + nSize) 中的完整帧，文本追加到 strOut，
+  // 返回用掉的字节数；末尾不完整的帧留给下一次调用。数据损坏时抛出异常。
+  // 遇到映射文件预分配留下的 0 时认为数据已经结束
+  size_t decode(const char* pData, size_t nSize, std::string& strOut);
+
+ private:
+  struct Format {
+    bool bValid = false;
+    long nLevel = 0;
+    int nLine = 0;
+    std::string strFile;
+    std::string strFmt;
+  };
+
+  std::vector<Format> m_vecFormats;
+};
+}  // namespace playground
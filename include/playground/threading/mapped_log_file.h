@@ -0,0 +1,49 @@
+#pragma once
+#include <cstddef>
+#include <string>
+
+namespace playground {
+// 预分配并映射到内存的日志文件，写入只是 memcpy，不经过系统调用。
+// 打开时用 fallocate 一次分配好磁盘空间，写满后按需扩展；
+// 关闭时把文件截断到实际写入的长度。
+// 映射的页属于内核的页缓存：写入后其他进程立即可读，程序崩溃也不会丢失，
+// 这时文件末尾会留下未写入的 0。不支持的平台上 open 返回 false
+class MappedLogFile {
+ public:
+  MappedLogFile() = default;
+  ~MappedLogFile();
+
+  MappedLogFile(const MappedLogFile&) = delete;
+  MappedLogFile& operator=(const MappedLogFile&) = delete;
+  MappedLogFile(MappedLogFile&& rhs) noexcept;
+  MappedLogFile& operator=(MappedLogFile&& rhs) noexcept;
+
+  // 新建 strPath（已存在时覆盖），预分配并映射 nCapacity 字节。
+  // 已打开的文件先关闭
+  bool open(const std::string& strPath, size_t nCapacity);
+  // 追加数据，超出预分配的大小时扩展文件并重新映射
+  bool write(const char* pData, size_t nSize);
+  // 文件改名，映射不受影响。用于把提前建好的文件换成正式的名字
+  bool rename(const std::string& strPath);
+  // 截断到已写入的长度并关闭
+  void close();
+  // 关闭并删除文件
+  void discard();
+
+  bool isOpen() const { return m_pData != nullptr; }
+  size_t size() const { return m_nSize; }
+  const std::string& path() const { return m_strPath; }
+
+ private:
+  // 把文件扩展到至少 nCapacity 字节并重新映射
+  bool grow(size_t nCapacity);
+  // 解除映射并关闭文件描述符，不截断
+  void release();
+
+  int m_nFd = -1;
+  char* m_pData = nullptr;
+  size_t m_nCapacity = 0;  // 已分配并映射的字节数
+  size_t m_nSize = 0;      // 已写入的字节数
+  std::string m_strPath;
+};
+}  // namespace playground
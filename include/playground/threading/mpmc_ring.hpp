@@ -0,0 +1,105 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <utility>
+
+namespace playground {
+// 有界多生产者多消费者环形队列（Dmitry Vyukov 的算法）。
+// 每个槽位带一个序号：序号等于入队位置时槽位可写，等于入队位置 + 1 时可读。
+// 生产者之间、消费者之间各自只竞争一个位置计数器，两端不共享任何锁。
+template <typename T>
+class MpmcRing {
+ public:
+  // 容量向上取整到 2 的幂，至少为 2
+  explicit MpmcRing(std::size_t capacity) {
+    std::size_t size = 2;
+    while (size < capacity) size *= 2;
+    mask_ = size - 1;
+    cells_.reset(new Cell[size]);
+    for (std::size_t i = 0; i < size; i++) {
+      cells_[i].seq.store(i, std::memory_order_relaxed);
+    }
+  }
+  MpmcRing(const MpmcRing&) = delete;
+  MpmcRing& operator=(const MpmcRing&) = delete;
+  ~MpmcRing() {
+    T value;
+    while (try_pop(value)) {
+    }
+  }
+
+  std::size_t capacity() const { return mask_ + 1; }
+
+  // 队列满时返回 false，此时 value 保持不变
+  bool try_push(T&& value) {
+    std::size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+    Cell* cell;
+    while (true) {
+      cell = &cells_[pos & mask_];
+      const std::size_t seq = cell->seq.load(std::memory_order_acquire);
+      const auto diff =
+          static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos);
+      if (diff == 0) {
+        if (enqueue_pos_.compare_exchange_weak(pos, pos + 1,
+                                               std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = enqueue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+    ::new (static_cast<void*>(cell->storage)) T(std::move(value));
+    cell->seq.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  // 队列空时返回 false
+  bool try_pop(T& value) {
+    std::size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+    Cell* cell;
+    while (true) {
+      cell = &cells_[pos & mask_];
+      const std::size_t seq = cell->seq.load(std::memory_order_acquire);
+      const auto diff = static_cast<std::ptrdiff_t>(seq) -
+                        static_cast<std::ptrdiff_t>(pos + 1);
+      if (diff == 0) {
+        if (dequeue_pos_.compare_exchange_weak(pos, pos + 1,
+                                               std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = dequeue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+    T* item = std::launder(reinterpret_cast<T*>(cell->storage));
+    value = std::move(*item);
+    item->~T();
+    cell->seq.store(pos + mask_ + 1, std::memory_order_release);
+    return true;
+  }
+
+  // 近似判断：已有生产者占到位置、但尚未写完的元素也算作非空
+  bool empty() const {
+    return enqueue_pos_.load(std::memory_order_acquire) ==
+           dequeue_pos_.load(std::memory_order_acquire);
+  }
+
+ private:
+  struct Cell {
+    std::atomic<std::size_t> seq;
+    alignas(T) unsigned char storage[sizeof(T)];
+  };
+
+  std::unique_ptr<Cell[]> cells_;
+  std::size_t mask_ = 0;
+  // 入队与出队位置分处不同缓存行，生产者与消费者不互相伪共享
+  alignas(64) std::atomic<std::size_t> enqueue_pos_{0};
+  alignas(64) std::atomic<std::size_t> dequeue_pos_{0};
+};
+}  // namespace playground
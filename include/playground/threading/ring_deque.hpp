@@ -0,0 +1,88 @@
+#ifndef PLAYGROUND_THREADING_RING_DEQUE_H_
+#define PLAYGROUND_THREADING_RING_DEQUE_H_
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <utility>
+
+namespace playground {
+// 基于 2 的幂容量环形数组的队列，非线程安全。
+// 容量只增不减：std::deque 在头部弹出、尾部压入时会反复释放/申请内存块，
+// 这里在达到稳定容量后入队出队都不再分配内存。
+template <typename T>
+class RingDeque {
+ public:
+  RingDeque() = default;
+  RingDeque(const RingDeque&) = delete;
+  RingDeque& operator=(const RingDeque&) = delete;
+  ~RingDeque() {
+    clear();
+    if (data_) {
+      std::allocator<T>().deallocate(data_, capacity_);
+    }
+  }
+
+  bool empty() const { return size_ == 0; }
+  std::size_t size() const { return size_; }
+
+  void push_back(T&& value) {
+    if (size_ == capacity_) {
+      grow();
+    }
+    ::new (static_cast<void*>(data_ + ((head_ + size_) & (capacity_ - 1))))
+        T(std::move(value));
+    ++size_;
+  }
+
+  T& front() { return data_[head_]; }
+  T& back() { return data_[(head_ + size_ - 1) & (capacity_ - 1)]; }
+
+  void pop_front() {
+    data_[head_].~T();
+    head_ = (head_ + 1) & (capacity_ - 1);
+    --size_;
+  }
+
+  void pop_back() {
+    back().~T();
+    --size_;
+  }
+
+  void clear() {
+    while (size_ != 0) {
+      pop_front();
+    }
+    head_ = 0;
+  }
+
+  void swap(RingDeque& other) noexcept {
+    std::swap(data_, other.data_);
+    std::swap(capacity_, other.capacity_);
+    std::swap(head_, other.head_);
+    std::swap(size_, other.size_);
+  }
+
+ private:
+  void grow() {
+    const std::size_t new_capacity = capacity_ == 0 ? 16 : capacity_ * 2;
+    T* new_data = std::allocator<T>().allocate(new_capacity);
+    for (std::size_t i = 0; i < size_; i++) {
+      T& old = data_[(head_ + i) & (capacity_ - 1)];
+      ::new (static_cast<void*>(new_data + i)) T(std::move(old));
+      old.~T();
+    }
+    if (data_) {
+      std::allocator<T>().deallocate(data_, capacity_);
+    }
+    data_ = new_data;
+    capacity_ = new_capacity;
+    head_ = 0;
+  }
+
+  T* data_ = nullptr;
+  std::size_t capacity_ = 0;
+  std::size_t head_ = 0;
+  std::size_t size_ = 0;
+};
+}  // namespace playground
+#endif
@@ -0,0 +1,99 @@
+#pragma once
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "playground/threading/inplace_task.hpp"
+#include "playground/threading/ring_deque.hpp"
+#include "playground/threading/task_future.h"
+#include "playground/threading/thread_pool.h"
+
+namespace playground {
+// 构建在 ThreadPool 之上的串行执行器：同一个 strand 的任务按提交顺序逐个执行，
+// 任意时刻至多一个在运行，因此任务访问的状态无需再加锁；不同 strand 之间并行。
+// 积压的任务在一个池任务中成批执行，不会每个任务都付出一次线程池调度开销。
+// 拷贝得到的 Strand 与原对象共享同一个队列；Strand 销毁后已提交的任务仍会执行
+class Strand {
+ public:
+  explicit Strand(ThreadPool& pool,
+                  TaskPriority priority = TaskPriority::kNormal);
+
+  // 提交不需要结果的任务，异常只会被记录。满足 TaskFuture::then 的执行器要求
+  template <typename F>
+  void execute(F&& fn) {
+    post(InplaceTask(std::forward<F>(fn)));
+  }
+
+  template <typename F, typename... Args>
+  auto addTask(F&& fn, Args&&... args) -> TaskFuture<
+      std::invoke_result_t<std::decay_t<F>, std::decay_t<Args>...>>;
+
+ private:
+  struct State {
+    State(ThreadPool& pool, TaskPriority priority)
+        : pool(pool), priority(priority) {}
+
+    ThreadPool& pool;
+    const TaskPriority priority;
+    std::mutex mtx;
+    RingDeque<InplaceTask> pending;
+    // 只由正在执行批次的池任务访问，与 pending 交换以复用容量
+    RingDeque<InplaceTask> running;
+    // 是否已有池任务在执行或等待执行本 strand 的批次
+    bool scheduled = false;
+  };
+
+  void post(InplaceTask task);
+  static void runBatches(const std::shared_ptr<State>& state);
+
+  std::shared_ptr<State> state_;
+};
+
+template <typename F, typename... Args>
+auto Strand::addTask(F&& fn, Args&&... args) -> TaskFuture<
+    std::invoke_result_t<std::decay_t<F>, std::decay_t<Args>...>> {
+  using R = std::invoke_result_t<std::decay_t<F>, std::decay_t<Args>...>;
+  TaskPromise<R> promise(nullptr);
+  TaskFuture<R> res = promise.get_future();
+  post(InplaceTask([promise = std::move(promise), fn = std::forward<F>(fn),
+                    ... args = std::forward<Args>(args)]() mutable {
+    promise.run(std::move(fn), std::move(args)...);
+  }));
+  return res;
+}
+
+// 按键把任务分派到固定数量的 strand 上：同一个键的任务串行执行。
+// 不同的键可能散列到同一个 strand 而被串行化，stripes 越多冲突越少
+template <typename Key, typename Hash = std::hash<Key>>
+class StrandGroup {
+ public:
+  StrandGroup(ThreadPool& pool, size_t stripes,
+              TaskPriority priority = TaskPriority::kNormal) {
+    if (stripes == 0) stripes = 1;
+    strands_.reserve(stripes);
+    for (size_t i = 0; i < stripes; i++) strands_.emplace_back(pool, priority);
+  }
+
+  Strand& strandFor(const Key& key) {
+    return strands_[hash_(key) % strands_.size()];
+  }
+
+  template <typename F>
+  void execute(const Key& key, F&& fn) {
+    strandFor(key).execute(std::forward<F>(fn));
+  }
+
+  template <typename F, typename... Args>
+  auto addTask(const Key& key, F&& fn, Args&&... args) {
+    return strandFor(key).addTask(std::forward<F>(fn),
+                                  std::forward<Args>(args)...);
+  }
+
+ private:
+  std::vector<Strand> strands_;
+  Hash hash_;
+};
+}  // namespace playground
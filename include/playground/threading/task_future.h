@@ -0,0 +1,490 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <memory>
+#include <new>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "playground/threading/inplace_task.hpp"
+
+namespace playground {
+// 定长内存块的回收池，为 TaskPromise / TaskFuture 的共享状态提供内存。
+// 空闲块挂在带版本号的无锁链表上，稳态下分配与回收都不调用 malloc；
+// 只有链表耗尽时才加锁申请一整块新的 chunk。
+// 回收池自身带引用计数：拥有者（线程池）和每个已分配的块各持有一份，
+// 因此线程池析构后仍在外部存活的 future 可以安全地归还内存。
+class TaskStateSlab {
+ public:
+  static constexpr std::size_t kBlockSize = 128;
+  static constexpr std::size_t kBlockAlign = alignof(std::max_align_t);
+  static constexpr std::uint32_t kNoBlock = UINT32_MAX;
+
+  static TaskStateSlab* create() { return new TaskStateSlab(); }
+
+  TaskStateSlab(const TaskStateSlab&) = delete;
+  TaskStateSlab& operator=(const TaskStateSlab&) = delete;
+
+  // 返回块编号，达到容量上限时返回 kNoBlock，调用方应退回到 operator new
+  std::uint32_t allocate();
+  void deallocate(std::uint32_t index);
+  void* blockAt(std::uint32_t index) const {
+    return chunks_[index / kBlocksPerChunk]
+        .load(std::memory_order_acquire)
+        ->blocks[index % kBlocksPerChunk]
+        .bytes;
+  }
+
+  // 拥有者放弃引用；最后一个块归还后才真正释放
+  void release();
+
+ private:
+  static constexpr std::uint32_t kBlocksPerChunk = 256;
+  static constexpr std::uint32_t kMaxChunks = 4096;
+
+  struct Block {
+    alignas(kBlockAlign) unsigned char bytes[kBlockSize];
+  };
+  struct Chunk {
+    Block blocks[kBlocksPerChunk];
+    std::atomic<std::uint32_t> next[kBlocksPerChunk];
+  };
+
+  TaskStateSlab() = default;
+  ~TaskStateSlab();
+
+  std::atomic<std::uint32_t>& nextOf(std::uint32_t index) const {
+    return chunks_[index / kBlocksPerChunk]
+        .load(std::memory_order_acquire)
+        ->next[index % kBlocksPerChunk];
+  }
+  bool grow();
+  void unref();
+
+  // 高 32 位为版本号（防 ABA），低 32 位为链表头的块编号
+  std::atomic<std::uint64_t> head_{kNoBlock};
+  std::atomic<std::size_t> refs_{1};
+  std::atomic<Chunk*> chunks_[kMaxChunks] = {};
+  std::uint32_t chunk_count_ = 0;
+  std::mutex grow_mtx_;
+};
+
+template <typename R>
+class TaskFuture;
+template <typename R>
+class TaskPromise;
+
+// promise 与 future 之间的共享状态。就绪状态用 std::atomic 的 wait/notify 等待，
+// 不需要额外的互斥量和条件变量。
+// 就绪回调挂在无锁链表上，由设置结果的线程在发布结果后依次调用
+template <typename R>
+class TaskState {
+ public:
+  static TaskState* create(TaskStateSlab* slab) {
+    if constexpr (sizeof(TaskState) <= TaskStateSlab::kBlockSize &&
+                  alignof(TaskState) <= TaskStateSlab::kBlockAlign) {
+      if (slab) {
+        const std::uint32_t index = slab->allocate();
+        if (index != TaskStateSlab::kNoBlock) {
+          return ::new (slab->blockAt(index)) TaskState(slab, index);
+        }
+      }
+    }
+    return new TaskState(nullptr, TaskStateSlab::kNoBlock);
+  }
+
+  void addRef() { refs_.fetch_add(1, std::memory_order_relaxed); }
+  void release() {
+    if (refs_.fetch_sub(1, std::memory_order_acq_rel) != 1) return;
+    TaskStateSlab* slab = slab_;
+    const std::uint32_t index = slab_index_;
+    if (slab) {
+      this->~TaskState();
+      slab->deallocate(index);
+    } else {
+      delete this;
+    }
+  }
+
+  bool ready() const {
+    return status_.load(std::memory_order_acquire) != kPending;
+  }
+  TaskStateSlab* slab() const { return slab_; }
+
+  // 已就绪时在当前线程直接调用 fn，异常传给调用方；
+  // 否则挂到链表上，就绪时由设置结果的线程调用，异常被忽略
+  template <typename F>
+  void onReady(F&& fn) {
+    std::unique_ptr<Continuation> node(
+        new Continuation{InplaceTask(std::forward<F>(fn)), nullptr});
+    Continuation* head = continuations_.load(std::memory_order_acquire);
+    while (head != fired()) {
+      node->next = head;
+      if (continuations_.compare_exchange_weak(head, node.get(),
+                                               std::memory_order_release,
+                                               std::memory_order_acquire)) {
+        node.release();
+        return;
+      }
+    }
+    node->fn();
+  }
+  void wait() const {
+    std::uint32_t status;
+    while ((status = status_.load(std::memory_order_acquire)) == kPending) {
+      status_.wait(status, std::memory_order_acquire);
+    }
+  }
+
+  template <typename... V>
+  void setValue(V&&... value) {
+    if constexpr (!std::is_void_v<R>) {
+      ::new (static_cast<void*>(storage_)) Stored(std::forward<V>(value)...);
+    }
+    publish(kValue);
+  }
+  void setException(std::exception_ptr e) {
+    error_ = std::move(e);
+    publish(kError);
+  }
+
+  R take() {
+    wait();
+    if (status_.load(std::memory_order_relaxed) == kError) {
+      std::rethrow_exception(error_);
+    }
+    if constexpr (std::is_void_v<R>) {
+      return;
+    } else if constexpr (std::is_reference_v<R>) {
+      return static_cast<R>(**value());
+    } else {
+      return std::move(*value());
+    }
+  }
+
+ private:
+  // 引用类型的结果保存为指针
+  using Stored =
+      std::conditional_t<std::is_reference_v<R>,
+                         std::add_pointer_t<std::remove_reference_t<R>>,
+                         std::conditional_t<std::is_void_v<R>, char, R>>;
+  enum : std::uint32_t { kPending, kValue, kError };
+
+  struct Continuation {
+    InplaceTask fn;
+    Continuation* next;
+  };
+  // 链表头的哨兵值，表示回调已经执行过，之后挂上的回调直接执行
+  static Continuation* fired() {
+    return reinterpret_cast<Continuation*>(alignof(Continuation));
+  }
+
+  TaskState(TaskStateSlab* slab, std::uint32_t index)
+      : slab_(slab), slab_index_(index) {}
+  ~TaskState() {
+    Continuation* node = continuations_.load(std::memory_order_relaxed);
+    while (node && node != fired()) {
+      delete std::exchange(node, node->next);
+    }
+    if constexpr (!std::is_void_v<R>) {
+      if (status_.load(std::memory_order_relaxed) == kValue) {
+        value()->~Stored();
+      }
+    }
+  }
+
+  Stored* value() { return std::launder(reinterpret_cast<Stored*>(storage_)); }
+
+  void publish(std::uint32_t status) {
+    status_.store(status, std::memory_order_release);
+    status_.notify_all();
+    // 调用方（promise）仍持有引用，回调执行期间共享状态不会被释放
+    Continuation* node =
+        continuations_.exchange(fired(), std::memory_order_acq_rel);
+    while (node) {
+      std::unique_ptr<Continuation> current(
+          std::exchange(node, node->next));
+      try {
+        current->fn();
+      } catch (...) {
+      }
+    }
+  }
+
+  std::atomic<std::uint32_t> status_{kPending};
+  std::atomic<std::uint32_t> refs_{1};
+  std::atomic<Continuation*> continuations_{nullptr};
+  TaskStateSlab* slab_;
+  std::uint32_t slab_index_;
+  std::exception_ptr error_;
+  alignas(Stored) unsigned char storage_[sizeof(Stored)];
+};
+
+// 与 std::future 用法一致的轻量 future：get() 取走结果后失效
+template <typename R>
+class TaskFuture {
+ public:
+  TaskFuture() = default;
+  TaskFuture(TaskFuture&& other) noexcept
+      : state_(std::exchange(other.state_, nullptr)) {}
+  TaskFuture& operator=(TaskFuture&& other) noexcept {
+    if (&other == this) {
+      return *this;
+    }
+    reset();
+    state_ = std::exchange(other.state_, nullptr);
+    return *this;
+  }
+  TaskFuture(const TaskFuture&) = delete;
+  TaskFuture& operator=(const TaskFuture&) = delete;
+  ~TaskFuture() { reset(); }
+
+  bool valid() const { return state_ != nullptr; }
+  bool ready() const { return state_ && state_->ready(); }
+  void wait() const {
+    if (!state_) throw std::future_error(std::future_errc::no_state);
+    state_->wait();
+  }
+
+  // 结果就绪后把 fn(就绪的 future) 提交给 executor，返回 fn 结果的 future；
+  // 本 future 随之失效。等待期间不占用任何线程。
+  // executor 需提供 execute(可调用对象)，例如 ThreadPool
+  template <typename Executor, typename F>
+  auto then(Executor& executor, F&& fn)
+      -> TaskFuture<std::invoke_result_t<std::decay_t<F>, TaskFuture>>;
+
+  // 低层接口：结果就绪时在设置结果的线程上调用 fn()，已就绪时立即调用。
+  // fn 应当很短且不阻塞，例如只是把后续任务提交出去
+  template <typename F>
+  void onReady(F&& fn) {
+    if (!state_) throw std::future_error(std::future_errc::no_state);
+    state_->onReady(std::forward<F>(fn));
+  }
+
+  R get() {
+    if (!state_) throw std::future_error(std::future_errc::no_state);
+    // 无论正常返回还是抛出异常，都释放共享状态
+    struct Releaser {
+      TaskFuture* self;
+      ~Releaser() { self->reset(); }
+    } releaser{this};
+    return state_->take();
+  }
+
+ private:
+  friend class TaskPromise<R>;
+  explicit TaskFuture(TaskState<R>* state) : state_(state) {}
+
+  void reset() {
+    if (state_) {
+      std::exchange(state_, nullptr)->release();
+    }
+  }
+
+  TaskState<R>* state_ = nullptr;
+};
+
+template <typename R>
+class TaskPromise {
+ public:
+  TaskPromise() = default;
+  explicit TaskPromise(TaskStateSlab* slab)
+      : state_(TaskState<R>::create(slab)) {}
+  TaskPromise(TaskPromise&& other) noexcept
+      : state_(std::exchange(other.state_, nullptr)),
+        satisfied_(other.satisfied_) {}
+  TaskPromise& operator=(TaskPromise&& other) noexcept {
+    if (&other == this) {
+      return *this;
+    }
+    abandon();
+    state_ = std::exchange(other.state_, nullptr);
+    satisfied_ = other.satisfied_;
+    return *this;
+  }
+  TaskPromise(const TaskPromise&) = delete;
+  TaskPromise& operator=(const TaskPromise&) = delete;
+  // 未设置结果就销毁（例如任务被 abort 丢弃），future 会得到 broken_promise
+  ~TaskPromise() { abandon(); }
+
+  TaskFuture<R> get_future() {
+    state_->addRef();
+    return TaskFuture<R>(state_);
+  }
+
+  template <typename... V>
+  void set_value(V&&... value) {
+    satisfied_ = true;
+    state_->setValue(std::forward<V>(value)...);
+  }
+  void set_exception(std::exception_ptr e) {
+    satisfied_ = true;
+    state_->setException(std::move(e));
+  }
+
+  // 调用 fn(args...) 并把返回值或异常写入共享状态
+  template <typename F, typename... Args>
+  void run(F&& fn, Args&&... args) {
+    try {
+      if constexpr (std::is_void_v<R>) {
+        std::invoke(std::forward<F>(fn), std::forward<Args>(args)...);
+        set_value();
+      } else if constexpr (std::is_reference_v<R>) {
+        set_value(
+            &std::invoke(std::forward<F>(fn), std::forward<Args>(args)...));
+      } else {
+        set_value(
+            std::invoke(std::forward<F>(fn), std::forward<Args>(args)...));
+      }
+    } catch (...) {
+      set_exception(std::current_exception());
+    }
+  }
+
+ private:
+  void abandon() {
+    if (!state_) return;
+    if (!satisfied_) {
+      state_->setException(std::make_exception_ptr(
+          std::future_error(std::future_errc::broken_promise)));
+    }
+    std::exchange(state_, nullptr)->release();
+  }
+
+  TaskState<R>* state_ = nullptr;
+  bool satisfied_ = false;
+};
+
+template <typename R>
+template <typename Executor, typename F>
+auto TaskFuture<R>::then(Executor& executor, F&& fn)
+    -> TaskFuture<std::invoke_result_t<std::decay_t<F>, TaskFuture>> {
+  using U = std::invoke_result_t<std::decay_t<F>, TaskFuture>;
+  if (!state_) throw std::future_error(std::future_errc::no_state);
+  TaskState<R>* state = state_;
+  // 后续任务的共享状态与本任务来自同一个回收池
+  TaskPromise<U> promise(state->slab());
+  TaskFuture<U> result = promise.get_future();
+  state->onReady([&executor, promise = std::move(promise),
+                  fn = std::forward<F>(fn),
+                  source = std::move(*this)]() mutable {
+    executor.execute([promise = std::move(promise), fn = std::move(fn),
+                      source = std::move(source)]() mutable {
+      promise.run(std::move(fn), std::move(source));
+    });
+  });
+  return result;
+}
+
+// 所有输入就绪后就绪，结果按原顺序包含全部输入 future
+template <typename R>
+TaskFuture<std::vector<TaskFuture<R>>> whenAll(
+    std::vector<TaskFuture<R>> futures) {
+  using Result = std::vector<TaskFuture<R>>;
+  struct Shared {
+    Result futures;
+    // 多计一次，挂完所有回调后再减，避免挂回调的途中结果就被移走
+    std::atomic<size_t> remaining{0};
+    TaskPromise<Result> promise{nullptr};
+  };
+  for (const auto& future : futures) {
+    if (!future.valid()) {
+      throw std::future_error(std::future_errc::no_state);
+    }
+  }
+
+  auto shared = std::make_shared<Shared>();
+  shared->futures = std::move(futures);
+  shared->remaining = shared->futures.size() + 1;
+  TaskFuture<Result> result = shared->promise.get_future();
+  auto arrive = [shared] {
+    if (shared->remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      shared->promise.set_value(std::move(shared->futures));
+    }
+  };
+  for (auto& future : shared->futures) future.onReady(arrive);
+  arrive();
+  return result;
+}
+
+template <typename... Rs>
+TaskFuture<std::tuple<TaskFuture<Rs>...>> whenAll(TaskFuture<Rs>... futures) {
+  using Result = std::tuple<TaskFuture<Rs>...>;
+  struct Shared {
+    Result futures;
+    std::atomic<size_t> remaining{sizeof...(Rs) + 1};
+    TaskPromise<Result> promise{nullptr};
+  };
+  if (!(futures.valid() && ...)) {
+    throw std::future_error(std::future_errc::no_state);
+  }
+
+  auto shared = std::make_shared<Shared>();
+  shared->futures = Result(std::move(futures)...);
+  TaskFuture<Result> result = shared->promise.get_future();
+  auto arrive = [shared] {
+    if (shared->remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      shared->promise.set_value(std::move(shared->futures));
+    }
+  };
+  std::apply([&arrive](auto&... each) { (each.onReady(arrive), ...); },
+             shared->futures);
+  arrive();
+  return result;
+}
+
+template <typename R>
+struct WhenAnyResult {
+  // 最先就绪的输入下标，输入为空时为 size_t(-1)
+  size_t index = static_cast<size_t>(-1);
+  std::vector<TaskFuture<R>> futures;
+};
+
+// 任一输入就绪后就绪，结果包含全部输入 future 及最先就绪者的下标
+template <typename R>
+TaskFuture<WhenAnyResult<R>> whenAny(std::vector<TaskFuture<R>> futures) {
+  struct Shared {
+    WhenAnyResult<R> result;
+    std::atomic<bool> decided{false};
+    // 胜出的回调与挂回调的循环各减一次，归零者设置结果
+    std::atomic<unsigned int> gate{2};
+    TaskPromise<WhenAnyResult<R>> promise{nullptr};
+  };
+  for (const auto& future : futures) {
+    if (!future.valid()) {
+      throw std::future_error(std::future_errc::no_state);
+    }
+  }
+
+  auto shared = std::make_shared<Shared>();
+  TaskFuture<WhenAnyResult<R>> result = shared->promise.get_future();
+  if (futures.empty()) {
+    shared->promise.set_value(WhenAnyResult<R>{});
+    return result;
+  }
+  shared->result.futures = std::move(futures);
+  auto pass = [shared] {
+    if (shared->gate.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      shared->promise.set_value(std::move(shared->result));
+    }
+  };
+  const size_t count = shared->result.futures.size();
+  for (size_t i = 0; i < count; i++) {
+    shared->result.futures[i].onReady([shared, pass, i] {
+      if (!shared->decided.exchange(true, std::memory_order_acq_rel)) {
+        shared->result.index = i;
+        pass();
+      }
+    });
+  }
+  pass();
+  return result;
+}
+}  // namespace playground
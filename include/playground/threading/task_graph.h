@@ -0,0 +1,61 @@
+#pragma once
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "playground/threading/inplace_task.hpp"
+#include "playground/threading/thread_pool.h"
+
+namespace playground {
+// 由任务及其依赖关系组成的有向无环图。
+// 每个任务在所有前驱完成后才被提交到线程池，执行期间没有线程阻塞等待前驱。
+// 某个任务抛出异常后，尚未开始的任务不再执行，run() 返回的句柄重新抛出该异常。
+// run() 返回的句柄完成前，图对象必须存活且不能修改或再次 run()
+class TaskGraph {
+ public:
+  using NodeId = size_t;
+
+  TaskGraph() = default;
+  TaskGraph(const TaskGraph&) = delete;
+  TaskGraph& operator=(const TaskGraph&) = delete;
+
+  // 添加一个无参任务，同一个图多次 run() 时任务会被多次调用
+  template <typename F>
+  NodeId add(F&& fn) {
+    nodes_.push_back(std::make_unique<Node>(std::forward<F>(fn)));
+    return nodes_.size() - 1;
+  }
+
+  // before 完成后 after 才能开始
+  void precede(NodeId before, NodeId after);
+
+  size_t size() const { return nodes_.size(); }
+
+  // 提交所有没有前驱的任务后立即返回；图中有环时抛出 std::logic_error。
+  // 提交失败时要么抛出异常且没有任务被提交，要么在当前线程执行无法排队的任务
+  BatchHandle run(ThreadPool& pool,
+                  TaskPriority priority = TaskPriority::kNormal);
+
+ private:
+  struct Node {
+    template <typename F>
+    explicit Node(F&& fn) : work(std::forward<F>(fn)) {}
+
+    InplaceTask work;
+    std::vector<NodeId> successors;
+    unsigned int predecessors = 0;
+    // 本次 run() 中尚未完成的前驱数
+    std::atomic<unsigned int> pending{0};
+  };
+
+  using StatePtr = std::shared_ptr<BatchHandle::State>;
+
+  void checkAcyclic() const;
+  void schedule(ThreadPool& pool, TaskPriority priority, NodeId id,
+                const StatePtr& state);
+  void runNode(ThreadPool& pool, TaskPriority priority, NodeId id,
+               const StatePtr& state);
+
+  std::vector<std::unique_ptr<Node>> nodes_;
+};
+}  // namespace playground
@@ -1,50 +1,544 @@
 #pragma once
+#include <atomic>
+#include <chrono>
 #include <condition_variable>
+#include <coroutine>
+#include <cstdint>
+#include <exception>
 #include <functional>
 #include <future>
-#include <queue>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
 #include <thread>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
+#include "playground/threading/cancellation.hpp"
+#include "playground/threading/inplace_task.hpp"
+#include "playground/threading/mpmc_ring.hpp"
+#include "playground/threading/ring_deque.hpp"
+#include "playground/threading/task_future.h"
+#include "playground/threading/timer_wheel.hpp"
+
 namespace playground {
+// 批量提交（addTasks / parallelFor）返回的完成句柄，代替 N 个 future。
+// 所有任务结束后 wait() 返回；若有任务抛出异常，wait() 重新抛出第一个异常。
+class BatchHandle {
+ public:
+  BatchHandle() = default;
+
+  bool valid() const { return state_ != nullptr; }
+  bool done() const;
+  void wait() const;
+
+ private:
+  friend class ThreadPool;
+  friend class TaskGraph;
+
+  struct State {
+    explicit State(size_t count) : remaining(count) {}
+    void finish(size_t count = 1);
+    void fail(std::exception_ptr e);
+
+    std::atomic<size_t> remaining;
+    std::atomic<bool> failed{false};
+    std::exception_ptr error;
+  };
+
+  explicit BatchHandle(std::shared_ptr<State> state)
+      : state_(std::move(state)) {}
+
+  std::shared_ptr<State> state_;
+};
+
+// 任务优先级。工作线程总是先处理高优先级车道，
+// 低优先级车道由 ThreadPool::kStarvationLimit 提供防饿死保护
+enum class TaskPriority : unsigned int { kHigh, kNormal, kLow };
+
+// 工作线程的绑核策略，NUMA 节点划分见 CpuTopology
+enum class WorkerPlacement : unsigned int {
+  kNone,     // 不绑核，由操作系统调度
+  kCompact,  // 先占满一个节点的 CPU，再使用下一个节点
+  kScatter,  // 依次轮流分配到各个节点
+  kExplicit  // 按 ThreadPoolOptions::cpus 依次绑定
+};
+
+// 任务队列的实现
+enum class QueueBackend : unsigned int {
+  kMutexDeque,   // 每个队列一把锁保护的无界环形数组
+  kLockFreeRing  // 有界无锁 MPMC 环，生产者与消费者不共享锁
+};
+
+// 有界队列已满时 addTask 的行为
+enum class OverflowPolicy : unsigned int {
+  kBlock,     // 等待队列腾出空间；工作线程内部提交时改为就地执行，避免死锁
+  kReject,    // 抛出 std::overflow_error
+  kRunInline  // 在提交线程上直接执行
+};
+
+struct ThreadPoolOptions {
+  // min_threads < max_threads 时为弹性模式：常驻 min_threads 个线程，
+  // 排队延迟超过 grow_latency 时逐个扩容到 max_threads，
+  // 多出来的线程空闲超过 idle_timeout 后退出
+  unsigned int min_threads = 1;
+  unsigned int max_threads = 1;
+  std::chrono::microseconds grow_latency{500};
+  std::chrono::milliseconds idle_timeout{5000};
+  // 空闲线程休眠前自旋检查新任务的次数，0 表示直接休眠。
+  // 自旋期间到达的任务无需 futex 唤醒即可被取走
+  unsigned int spin_count = 1000;
+  // 绑核后工作线程优先窃取同节点队列的任务，
+  // 绑核线程从外部提交的任务也优先放入同节点的队列
+  WorkerPlacement placement = WorkerPlacement::kNone;
+  // kExplicit 使用的 CPU 列表，线程数多于列表长度时循环使用
+  std::vector<unsigned int> cpus;
+  // kLockFreeRing 时每个线程每条优先级车道的容量（向上取整到 2 的幂），
+  // 以及所选队列和其他线程的队列都满时的处理方式。kMutexDeque 不受限制。
+  // 定时任务到期后不受容量限制，也不会在定时线程上执行或阻塞
+  QueueBackend backend = QueueBackend::kMutexDeque;
+  size_t queue_capacity = 1024;
+  OverflowPolicy overflow = OverflowPolicy::kBlock;
+};
+
+// 以 2 的幂为边界的延迟直方图：第 0 个桶统计 0ns，第 i 个桶统计
+// [2^(i-1), 2^i) ns，最后一个桶包含所有更大的值
+struct LatencyHistogram {
+  static constexpr unsigned int kBuckets = 32;
+
+  static unsigned int bucketOf(std::uint64_t ns);
+  std::uint64_t total() const;
+  // 第 p 分位（0~1）所在桶的上界，没有样本时返回 0
+  std::chrono::nanoseconds percentile(double p) const;
+
+  std::uint64_t counts[kBuckets] = {};
+};
+
+struct ThreadPoolStats;
+
+// 每个工作线程持有自己的任务队列：
+// - 工作线程内部提交的任务压入本线程队列，不经过任何全局锁；
+// - 外部线程提交的任务按轮询分散到各个工作线程的队列；
+// - 工作线程本地队列为空时，按 FIFO 顺序从其他线程的队列窃取任务。
+// 每个队列按优先级分成若干车道，取任务时先扫完所有线程的高优先级车道，
+// 再依次处理更低的车道。
 class ThreadPool {
  public:
+  static constexpr unsigned int kPriorityCount = 3;
+  // 连续处理这么多个更高优先级的任务后，若低优先级车道仍有积压，
+  // 就先从最低的非空车道取一个任务
+  static constexpr unsigned int kStarvationLimit = 16;
+
   ThreadPool(unsigned int num = -1);
+  explicit ThreadPool(const ThreadPoolOptions& options);
   ~ThreadPool() noexcept;
 
   using Task = std::function<void()>;
 
+  // 任务与参数被移动到队列中的 InplaceTask 内部，共享状态来自本池的回收池，
+  // 稳态下提交一个任务不产生堆分配。与 std::async 一致，执行时参数以右值传入
+  template <typename F, typename... Args>
+  auto addTask(F&& fn, Args&&... args) -> TaskFuture<
+      std::invoke_result_t<std::decay_t<F>, std::decay_t<Args>...>>;
+
+  // 指定优先级提交，不带优先级的 addTask 等价于 TaskPriority::kNormal
   template <typename F, typename... Args>
-  auto addTask(F&& fn, Args&&... args)
-      -> std::future<std::invoke_result_t<F, Args...>>;
+  auto addTask(TaskPriority priority, F&& fn, Args&&... args) -> TaskFuture<
+      std::invoke_result_t<std::decay_t<F>, std::decay_t<Args>...>>;
+
+  // 带取消令牌提交：出队时令牌已被取消的任务直接丢弃，不调用 fn，
+  // future 得到 TaskCancelled。取消本身只是设置标志，O(1)
+  template <typename F, typename... Args>
+  auto addTask(const CancellationToken& token, F&& fn, Args&&... args)
+      -> TaskFuture<
+          std::invoke_result_t<std::decay_t<F>, std::decay_t<Args>...>>;
+
+  template <typename F, typename... Args>
+  auto addTask(const CancellationToken& token, TaskPriority priority, F&& fn,
+               Args&&... args)
+      -> TaskFuture<
+          std::invoke_result_t<std::decay_t<F>, std::decay_t<Args>...>>;
+
+  // 提交不需要结果的无参可调用对象：不分配 future 共享状态，
+  // 任务抛出的异常只会被记录。TaskFuture::then 通过它提交后续任务
+  template <typename F>
+  void execute(F&& fn, TaskPriority priority = TaskPriority::kNormal) {
+    post(Job(std::forward<F>(fn)), priority);
+  }
+
+  // 批量提交无参可调用对象：整批任务在一次发布中入队，只唤醒需要的线程数
+  template <typename Range>
+  BatchHandle addTasks(Range&& tasks,
+                       TaskPriority priority = TaskPriority::kNormal);
+
+  // 把 [begin, end) 按 grain 切分成若干块批量提交，每个下标调用一次 fn(i)
+  template <typename Index, typename F>
+  BatchHandle parallelFor(Index begin, Index end, Index grain, F&& fn,
+                          TaskPriority priority = TaskPriority::kNormal);
+
+  // co_await pool.schedule()：挂起当前协程，随后在某个工作线程上恢复。
+  // 线程池已停止时 co_await 表达式抛出 std::logic_error。
+  // 恢复任务被 abort() 或 drainFor() 超时丢弃时协程保持挂起，
+  // 由持有它的一方负责销毁；spawn() 的起点会自行销毁
+  class ScheduleAwaiter {
+   public:
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> handle) {
+      pool_.execute([handle] { handle.resume(); }, priority_);
+    }
+    void await_resume() const noexcept {}
+
+   private:
+    friend class ThreadPool;
+    ScheduleAwaiter(ThreadPool& pool, TaskPriority priority)
+        : pool_(pool), priority_(priority) {}
+
+    ThreadPool& pool_;
+    TaskPriority priority_;
+  };
+
+  ScheduleAwaiter schedule(TaskPriority priority = TaskPriority::kNormal) {
+    return ScheduleAwaiter(*this, priority);
+  }
+
+ private:
+  struct Timer;
+
+ public:
+  // addTaskAfter / addPeriodic 返回的句柄，可在任意线程取消定时任务
+  class TimerHandle {
+   public:
+    TimerHandle() = default;
+
+    // 从时间轮中摘除，O(1)；已经到期、尚在队列中的那一次也会被跳过。
+    // 已取消过或一次性任务已经开始执行时返回 false
+    bool cancel();
+
+   private:
+    friend class ThreadPool;
+    explicit TimerHandle(std::weak_ptr<Timer> timer)
+        : timer_(std::move(timer)) {}
+
+    std::weak_ptr<Timer> timer_;
+  };
+
+  // delay 之后把 fn 投入工作队列。定时精度为 1ms，不会早于 delay 执行
+  template <typename F>
+  TimerHandle addTaskAfter(std::chrono::steady_clock::duration delay, F&& fn,
+                           TaskPriority priority = TaskPriority::kNormal) {
+    return addTimer(Job(std::forward<F>(fn)), delay,
+                    std::chrono::steady_clock::duration::zero(), priority);
+  }
+
+  // 按固定频率（以首次到期时间为基准）每隔 interval 执行一次 fn，直到被取消。
+  // 上一次还没执行完时跳过本次，同一个 fn 不会并发执行
+  template <typename F>
+  TimerHandle addPeriodic(std::chrono::steady_clock::duration interval, F&& fn,
+                          TaskPriority priority = TaskPriority::kNormal) {
+    if (interval <= std::chrono::steady_clock::duration::zero()) {
+      throw std::invalid_argument("Periodic interval must be positive!");
+    }
+    return addTimer(Job(std::forward<F>(fn)), interval, interval, priority);
+  }
 
   void stop();
   void abort();
+  // 停止接收新任务，在 timeout 内继续执行已入队的任务（已取消的直接跳过）；
+  // 超时后丢弃剩余任务（同 abort）。全部执行完毕返回 true，超时返回 false
+  bool drainFor(std::chrono::steady_clock::duration timeout);
+
+  // 当前存活的工作线程数，弹性模式下随负载变化
+  unsigned int threadCount() const {
+    return active_threads_.load(std::memory_order_relaxed);
+  }
+
+  // 某个优先级车道中已入队、尚未被取走的任务数
+  size_t queueDepth(TaskPriority priority) const {
+    const std::ptrdiff_t depth =
+        lanes_[static_cast<unsigned int>(priority)].depth.load(
+            std::memory_order_relaxed);
+    return depth > 0 ? static_cast<size_t>(depth) : 0;
+  }
+
+  // 读取运行统计。各计数器独立读取，结果不是严格一致的瞬间快照
+  ThreadPoolStats snapshot() const;
 
  private:
+  // 队列中实际保存的任务类型：只能移动，小对象原地存放
+  using Job = InplaceTask;
+  using Clock = std::chrono::steady_clock;
+
+  struct QueuedJob {
+    Job job;
+    Clock::time_point enqueued;
+  };
+
+  // 每个线程槽位一个队列，槽位数为 max_threads。
+  // 按缓存行对齐，避免相邻队列的锁互相伪共享
+  struct alignas(64) WorkerQueue {
+    std::mutex mtx;
+    RingDeque<QueuedJob> lanes[kPriorityCount];
+    // QueueBackend::kLockFreeRing 时代替 mtx + lanes，
+    // 此时 mtx + lanes 只存放到期的定时任务
+    std::unique_ptr<MpmcRing<QueuedJob>> rings[kPriorityCount];
+    // 连续取自更高优先级车道的任务数，只由所属工作线程读写
+    unsigned int streak = 0;
+    // 该槽位当前是否有工作线程，外部提交时跳过空槽位
+    std::atomic<bool> active{false};
+    // 绑定的 CPU（-1 为不绑核）及其所在节点
+    int cpu = -1;
+    unsigned int node = 0;
+    // 取任务的顺序：本队列、同节点的其他队列、其余队列
+    std::vector<unsigned int> victims;
+  };
+
+  // 每个槽位的运行统计，只由该槽位的工作线程写入、snapshot() 随时读取，
+  // 因此用 relaxed 的读后写代替原子加法。按缓存行对齐，互不伪共享
+  struct alignas(64) WorkerStats {
+    std::atomic<std::uint64_t> tasks{0};
+    std::atomic<std::uint64_t> steals{0};
+    std::atomic<std::uint64_t> busy_ns{0};
+    std::atomic<std::uint64_t> idle_ns{0};
+    std::atomic<std::uint64_t> queue_wait[LatencyHistogram::kBuckets];
+    std::atomic<std::uint64_t> run_time[LatencyHistogram::kBuckets];
+  };
+
+  // 各车道在所有队列中的总深度，互斥队列在队列锁内更新。
+  // 无锁环先入队后计数，消费者可能先于计数取走任务，因此允许短暂为负
+  struct alignas(64) LaneCounter {
+    std::atomic<std::ptrdiff_t> depth{0};
+  };
+
+  // 挂在时间轮上的定时任务。interval 以 tick（1ms）为单位，0 为一次性任务
+  struct Timer : TimerWheel::Node {
+    Job fn;
+    std::uint64_t interval = 0;
+    TaskPriority priority = TaskPriority::kNormal;
+    ThreadPool* pool = nullptr;
+    std::atomic<bool> cancelled{false};
+    // 周期任务的上一次是否还在队列中或正在执行
+    std::atomic<bool> running{false};
+    // 挂在时间轮上期间由时间轮持有，摘下时释放；只在 timer_mtx_ 内访问
+    std::shared_ptr<Timer> self;
+  };
+
+  void assignPlacement();
+  void post(Job task, TaskPriority priority);
+  void postUnbounded(Job task, TaskPriority priority);
+  void postBatch(std::vector<Job>& tasks, TaskPriority priority);
+  bool enqueueRing(Job task, unsigned int lane, unsigned int index,
+                   Clock::time_point now);
+  bool pushToRing(unsigned int index, unsigned int lane, QueuedJob& item);
+  unsigned int pickQueue();
+  void workerLoop(unsigned int index);
+  bool hasPending() const;
+  bool allQueuesEmpty();
+  bool popTask(unsigned int index, QueuedJob& item);
+  bool popFromLane(unsigned int index, unsigned int lane, QueuedJob& item);
+  bool spinForTask();
+  void wakeOne();
+  void wakeWorkers(size_t count);
+  void startWorker(unsigned int index);
+  void maybeGrow(Clock::time_point now);
+  bool tryRetire(unsigned int index);
+  TimerHandle addTimer(Job fn, Clock::duration delay, Clock::duration interval,
+                       TaskPriority priority);
+  bool cancelTimer(Timer& timer);
+  void fireTimer(std::shared_ptr<Timer> timer);
+  void timerLoop();
+  std::uint64_t currentTick() const;
+
+  const ThreadPoolOptions options_;
+  const bool elastic_;
+  const bool ring_;
+  // 以槽位为下标，退出的线程对象保留到槽位被复用或析构时再 join
   std::vector<std::thread> threads_;
-  std::queue<Task> task_list_;
+  std::vector<std::unique_ptr<WorkerQueue>> queues_;
+  std::unique_ptr<WorkerStats[]> stats_;
+  // 绑核时按节点分组的槽位，以及 CPU 编号到节点的映射，供外部提交选择同节点队列
+  std::vector<std::vector<unsigned int>> node_queues_;
+  std::vector<unsigned int> cpu_node_;
+  // addTask 的 promise/future 共享状态从这里分配
+  TaskStateSlab* state_slab_;
+  // 各车道的排队深度：取任务时用来跳过空车道，空闲线程据此判断是否休眠
+  LaneCounter lanes_[kPriorityCount];
+  std::atomic<unsigned int> next_queue_{0};
+  std::atomic<unsigned int> active_threads_{0};
+  // 在 cv_ 上休眠的线程数 / 正在自旋等待任务的线程数
+  std::atomic<unsigned int> idle_{0};
+  std::atomic<unsigned int> spinning_{0};
+  std::atomic<bool> stop_{false};
+  // 无锁环模式下已通过 stop_ 检查、尚未完成入队的提交数，
+  // 工作线程在它归零前不会因停止而退出
+  std::atomic<unsigned int> posting_{0};
+  // 无锁环模式下放在 mtx + lanes 中的任务数，为 0 时取任务不必加锁
+  std::atomic<std::ptrdiff_t> unbounded_{0};
+  std::atomic<Clock::rep> last_grow_{0};
+  // 用于空闲线程的休眠与唤醒，以及弹性模式下线程的增减，不保护任务队列
   std::condition_variable cv_;
+  // 停止后工作线程退出时通知 drainFor，同样配合 mtx_ 使用
+  std::condition_variable exit_cv_;
   std::mutex mtx_;
-  bool stop_ = false;
+
+  // 定时任务：时间轮及其线程在第一次添加定时任务时启动。
+  // 定时线程只负责推进时间轮，到期的任务照常投入工作队列
+  std::mutex timer_mtx_;
+  std::condition_variable timer_cv_;
+  std::thread timer_thread_;
+  TimerWheel wheel_;
+  // tick 0 对应的时刻
+  const Clock::time_point timer_epoch_;
+  // 定时线程休眠到这个 tick，更早到期的新定时器需要唤醒它；0 表示没有休眠
+  std::uint64_t wake_tick_ = 0;
+
+  // 当前线程所属的线程池及其队列下标，用于识别“本地提交”
+  static thread_local ThreadPool* tls_pool_;
+  static thread_local unsigned int tls_index_;
+};
+
+// ThreadPool::snapshot() 的结果，只包含普通数据，便于导出到监控系统
+struct ThreadPoolStats {
+  struct Worker {
+    // 槽位上当前是否有工作线程；弹性模式下退出的线程保留其累计值
+    bool active = false;
+    std::uint64_t tasks = 0;
+    // 从其他线程队列取得的任务数
+    std::uint64_t steals = 0;
+    std::chrono::nanoseconds busy{0};
+    std::chrono::nanoseconds idle{0};
+  };
+
+  unsigned int threads = 0;
+  // 以 TaskPriority 为下标
+  size_t queue_depth[ThreadPool::kPriorityCount] = {};
+  std::vector<Worker> workers;
+  // 所有线程合计：任务从入队到开始执行的等待时间、执行耗时
+  LatencyHistogram queue_wait;
+  LatencyHistogram run_time;
 };
 
 template <typename F, typename... Args>
-auto ThreadPool::addTask(F&& fn, Args&&... args)
-    -> std::future<std::invoke_result_t<F, Args...>> {
-  using R = std::invoke_result_t<F, Args...>;
-  auto task = std::make_shared<std::packaged_task<R()>>(
-      std::bind(std::forward<F>(fn), std::forward<Args>(args)...));
-  std::future<R> res = task->get_future();
-  {
-    std::lock_guard<std::mutex> lock(mtx_);
-    if (stop_) throw std::logic_error("Thread pool has stopped!");
-    auto lambda = [task] { (*task)(); };
-    task_list_.push(lambda);
-    cv_.notify_one();
-  }
+auto ThreadPool::addTask(F&& fn, Args&&... args) -> TaskFuture<
+    std::invoke_result_t<std::decay_t<F>, std::decay_t<Args>...>> {
+  return addTask(TaskPriority::kNormal, std::forward<F>(fn),
+                 std::forward<Args>(args)...);
+}
+
+template <typename F, typename... Args>
+auto ThreadPool::addTask(TaskPriority priority, F&& fn, Args&&... args)
+    -> TaskFuture<
+        std::invoke_result_t<std::decay_t<F>, std::decay_t<Args>...>> {
+  using R = std::invoke_result_t<std::decay_t<F>, std::decay_t<Args>...>;
+  TaskPromise<R> promise(state_slab_);
+  TaskFuture<R> res = promise.get_future();
+  Job job([promise = std::move(promise), fn = std::forward<F>(fn),
+           ... args = std::forward<Args>(args)]() mutable {
+    promise.run(std::move(fn), std::move(args)...);
+  });
+  post(std::move(job), priority);
+  return res;
+}
+
+template <typename F, typename... Args>
+auto ThreadPool::addTask(const CancellationToken& token, F&& fn,
+                         Args&&... args)
+    -> TaskFuture<
+        std::invoke_result_t<std::decay_t<F>, std::decay_t<Args>...>> {
+  return addTask(token, TaskPriority::kNormal, std::forward<F>(fn),
+                 std::forward<Args>(args)...);
+}
+
+template <typename F, typename... Args>
+auto ThreadPool::addTask(const CancellationToken& token, TaskPriority priority,
+                         F&& fn, Args&&... args)
+    -> TaskFuture<
+        std::invoke_result_t<std::decay_t<F>, std::decay_t<Args>...>> {
+  using R = std::invoke_result_t<std::decay_t<F>, std::decay_t<Args>...>;
+  TaskPromise<R> promise(state_slab_);
+  TaskFuture<R> res = promise.get_future();
+  Job job([promise = std::move(promise), token, fn = std::forward<F>(fn),
+           ... args = std::forward<Args>(args)]() mutable {
+    if (token.cancelled()) {
+      promise.set_exception(std::make_exception_ptr(TaskCancelled()));
+      return;
+    }
+    promise.run(std::move(fn), std::move(args)...);
+  });
+  post(std::move(job), priority);
   return res;
 }
 
+template <typename Range>
+BatchHandle ThreadPool::addTasks(Range&& tasks, TaskPriority priority) {
+  auto state = std::make_shared<BatchHandle::State>(0);
+  std::vector<Job> batch;
+  if constexpr (requires { std::size(tasks); }) {
+    batch.reserve(std::size(tasks));
+  }
+  auto add = [&batch, &state](auto&& fn) {
+    batch.emplace_back(
+        [state, task = std::forward<decltype(fn)>(fn)]() mutable {
+          try {
+            task();
+          } catch (...) {
+            state->fail(std::current_exception());
+          }
+          state->finish();
+        });
+  };
+  // 右值范围中的任务直接移走：只能移动的任务也能批量提交，且不必逐个复制
+  for (auto&& fn : tasks) {
+    if constexpr (std::is_lvalue_reference_v<Range>) {
+      add(fn);
+    } else {
+      add(std::move(fn));
+    }
+  }
+  state->remaining = batch.size();
+  postBatch(batch, priority);
+  return BatchHandle(std::move(state));
+}
+
+template <typename Index, typename F>
+BatchHandle ThreadPool::parallelFor(Index begin, Index end, Index grain,
+                                    F&& fn, TaskPriority priority) {
+  static_assert(std::is_integral_v<Index>, "parallelFor needs integer index");
+  if (grain <= 0) grain = 1;
+  // 距离按无符号类型计算：有符号的 end - begin 可能超出类型范围，
+  // 例如 [INT_MIN, INT_MAX)；也不写成 (distance + grain - 1) / grain
+  using Distance = std::make_unsigned_t<Index>;
+  const auto step = static_cast<Distance>(grain);
+  const Distance distance =
+      begin < end ? static_cast<Distance>(static_cast<Distance>(end) -
+                                          static_cast<Distance>(begin))
+                  : 0;
+  const size_t chunks =
+      static_cast<size_t>(distance / step + (distance % step != 0));
+
+  auto state = std::make_shared<BatchHandle::State>(chunks);
+  // 所有分块共享同一个函数对象，只分配一次
+  auto body = std::make_shared<std::decay_t<F>>(std::forward<F>(fn));
+  std::vector<Job> batch;
+  batch.reserve(chunks);
+  for (Index first = begin; first < end;) {
+    const auto left = static_cast<Distance>(static_cast<Distance>(end) -
+                                            static_cast<Distance>(first));
+    const Index last = left > step ? static_cast<Index>(first + grain) : end;
+    batch.emplace_back([state, body, first, last] {
+      try {
+        for (Index i = first; i < last; ++i) (*body)(i);
+      } catch (...) {
+        state->fail(std::current_exception());
+      }
+      state->finish();
+    });
+    first = last;
+  }
+  postBatch(batch, priority);
+  return BatchHandle(std::move(state));
+}
+
 void test_thread_pool();
 }  // namespace playground
@@ -85,7 +85,7 @@ class ThreadsafeQueue {
 
  private:
   std::unique_ptr<Node> head_;
-  std::mutex head_mtx_;
+  mutable std::mutex head_mtx_;
   Node* tail_;
   mutable std::mutex tail_mtx_;
   std::condition_variable cv_;
@@ -0,0 +1,184 @@
+#pragma once
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+namespace playground {
+// 分层时间轮，非线程安全。时间以整数 tick 表示，单位由使用者决定。
+// 共 kLevels 层，每层 kSlots 个槽：第 k 层一个槽覆盖 kSlots^k 个 tick，
+// 到期时间距当前不足 kSlots^(k+1) 的定时器挂在第 k 层；
+// 时间走到高层槽的起点时把其中的定时器重新分配（级联）到更低层。
+// 定时器是侵入式双向链表节点，插入和删除都是 O(1)，不分配内存。
+class TimerWheel {
+ public:
+  static constexpr unsigned int kLevels = 4;
+  static constexpr unsigned int kSlotBits = 6;
+  static constexpr unsigned int kSlots = 1u << kSlotBits;
+  static constexpr std::uint64_t kNever = UINT64_MAX;
+
+  struct Node {
+    Node* prev = nullptr;
+    Node* next = nullptr;
+    std::uint64_t expiry = 0;
+    std::uint8_t level = 0;
+    std::uint8_t slot = 0;
+    bool linked = false;
+  };
+
+  explicit TimerWheel(std::uint64_t now = 0) : now_(now) {}
+  TimerWheel(const TimerWheel&) = delete;
+  TimerWheel& operator=(const TimerWheel&) = delete;
+
+  // 已处理到的 tick：到期时间不晚于它的定时器都已触发
+  std::uint64_t now() const { return now_; }
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+  // 到期时间早于等于 now() 的定时器在下一个 tick 触发
+  void insert(Node* node, std::uint64_t expiry) {
+    node->expiry = expiry > now_ ? expiry : now_ + 1;
+    link(node);
+    size_++;
+  }
+
+  void remove(Node* node) {
+    if (!node->linked) return;
+    unlink(node);
+    size_--;
+  }
+
+  // 摘下所有定时器（不触发），对每个节点调用 release(node)
+  template <typename Release>
+  void clear(Release&& release) {
+    for (auto& level : slots_) {
+      for (Node*& head : level) {
+        while (Node* node = head) {
+          head = node->next;
+          node->prev = node->next = nullptr;
+          node->linked = false;
+          release(node);
+        }
+      }
+    }
+    for (auto& bits : occupied_) bits = 0;
+    size_ = 0;
+  }
+
+  // 下一个需要处理的 tick：最近的到期时间，或高层定时器级联的时刻。
+  // 可能早于真正的到期时间（级联后没有定时器到期），但不会晚于它
+  std::uint64_t nextTick() const {
+    if (size_ == 0) return kNever;
+    std::uint64_t next = kNever;
+    if (occupied_[0] != 0) {
+      // 从下一个槽开始循环查找第一个非空槽
+      const unsigned int index = now_ & (kSlots - 1);
+      const std::uint64_t rotated = std::rotr(occupied_[0], index + 1);
+      next = now_ + 1 + std::countr_zero(rotated);
+    }
+    for (unsigned int level = 1; level < kLevels; level++) {
+      if (occupied_[level] != 0) {
+        const std::uint64_t boundary = (now_ | (kSlots - 1)) + 1;
+        return boundary < next ? boundary : next;
+      }
+    }
+    return next;
+  }
+
+  // 处理 (now(), tick] 之间的所有 tick，对每个到期的定时器调用 fire(node)。
+  // 调用 fire 时节点已从时间轮移除，可以在 fire 中重新插入
+  template <typename Fire>
+  void advanceTo(std::uint64_t tick, Fire&& fire) {
+    while (now_ < tick) {
+      if (occupied_[0] == 0) {
+        // 第 0 层为空时直接跳到下一次级联，或者目标 tick
+        const std::uint64_t boundary = (now_ | (kSlots - 1)) + 1;
+        if (size_ == 0 || boundary > tick) {
+          now_ = tick;
+          return;
+        }
+        now_ = boundary - 1;
+      }
+      step(fire);
+    }
+  }
+
+ private:
+  template <typename Fire>
+  void step(Fire& fire) {
+    now_++;
+    // 低层转完一圈时，从低到高依次级联对应的高层槽
+    for (unsigned int level = 1; level < kLevels; level++) {
+      if (((now_ >> ((level - 1) * kSlotBits)) & (kSlots - 1)) != 0) break;
+      cascade(level, (now_ >> (level * kSlotBits)) & (kSlots - 1));
+    }
+
+    const unsigned int index = now_ & (kSlots - 1);
+    Node* node = slots_[0][index];
+    if (!node) return;
+    // 先摘下整条链表，fire 中重新插入的节点不会落到正在遍历的链表上
+    slots_[0][index] = nullptr;
+    occupied_[0] &= ~(1ull << index);
+    while (node) {
+      Node* next = node->next;
+      node->prev = node->next = nullptr;
+      node->linked = false;
+      size_--;
+      fire(node);
+      node = next;
+    }
+  }
+
+  void cascade(unsigned int level, unsigned int index) {
+    Node* node = slots_[level][index];
+    slots_[level][index] = nullptr;
+    occupied_[level] &= ~(1ull << index);
+    while (node) {
+      Node* next = node->next;
+      link(node);
+      node = next;
+    }
+  }
+
+  void link(Node* node) {
+    const std::uint64_t delta = node->expiry - now_;
+    unsigned int level = 0;
+    while (level + 1 < kLevels &&
+           delta >= (1ull << ((level + 1) * kSlotBits))) {
+      level++;
+    }
+    // 超出最高层范围的定时器先放在最高层最远的槽，级联时再重新计算
+    std::uint64_t expiry = node->expiry;
+    const std::uint64_t range = 1ull << (kLevels * kSlotBits);
+    if (delta >= range) expiry = now_ + range - 1;
+    const auto slot = static_cast<unsigned int>(
+        (expiry >> (level * kSlotBits)) & (kSlots - 1));
+
+    node->level = static_cast<std::uint8_t>(level);
+    node->slot = static_cast<std::uint8_t>(slot);
+    node->prev = nullptr;
+    node->next = slots_[level][slot];
+    if (node->next) node->next->prev = node;
+    slots_[level][slot] = node;
+    occupied_[level] |= 1ull << slot;
+    node->linked = true;
+  }
+
+  void unlink(Node* node) {
+    if (node->prev) {
+      node->prev->next = node->next;
+    } else {
+      slots_[node->level][node->slot] = node->next;
+      if (!node->next) occupied_[node->level] &= ~(1ull << node->slot);
+    }
+    if (node->next) node->next->prev = node->prev;
+    node->prev = node->next = nullptr;
+    node->linked = false;
+  }
+
+  Node* slots_[kLevels][kSlots] = {};
+  // 每层非空槽的位图
+  std::uint64_t occupied_[kLevels] = {};
+  std::uint64_t now_;
+  size_t size_ = 0;
+};
+}  // namespace playground
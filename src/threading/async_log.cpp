@@ -3,17 +3,26 @@
 #include <stdarg.h>
 #include <stdio.h>
 #include <string.h>
-#include <sys/timeb.h>
 #include <time.h>
+#ifdef _WIN32
 #include <windows.h>
+#else
+#include <unistd.h>
+#endif
 
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
 #include <ctime>
 #include <iostream>
 #include <sstream>
+#include <utility>
 
 namespace playground {
 #define MAX_LINE_LENGTH 256
 #define DEFAULT_ROLL_SIZE 10 * 1024 * 1024
+// 映射文件在 rollsize 之外多预留的空间，容纳轮转前写入的最后一批日志
+#define MAPPED_FILE_SLACK 64 * 1024
 
 bool CAsyncLog::m_bTruncateLongLog = false;
 FILE* CAsyncLog::m_hLogFile = NULL;
@@ -22,12 +31,185 @@ std::string CAsyncLog::m_strFileNamePID = "";
 LOG_LEVEL CAsyncLog::m_nCurrentLevel = LOG_LEVEL_INFO;
 int64_t CAsyncLog::m_nFileRollSize = DEFAULT_ROLL_SIZE;
 int64_t CAsyncLog::m_nCurrentWrittenSize = 0;
-std::list<std::string> CAsyncLog::m_listLinesToWrite;
+bool CAsyncLog::m_bConsoleEcho = true;
+LOG_FLUSH_POLICY CAsyncLog::m_nFlushPolicy = LOG_FLUSH_EVERY_LINE;
+int64_t CAsyncLog::m_nFlushValue = 0;
+int64_t CAsyncLog::m_nUnflushedSize = 0;
+std::chrono::steady_clock::time_point CAsyncLog::m_tpLastFlush;
+bool CAsyncLog::m_bBinaryFile = false;
+bool CAsyncLog::m_bMappedFile = false;
+MappedLogFile CAsyncLog::m_mappedFile;
+MappedLogFile CAsyncLog::m_nextMappedFile;
+size_t CAsyncLog::m_nQueueCapacity = 4096;
+LOG_QUEUE_POLICY CAsyncLog::m_nQueuePolicy = LOG_QUEUE_BLOCK;
+int64_t CAsyncLog::m_nQueueValue = 1;
+std::atomic<uint64_t> CAsyncLog::m_nDroppedLines[LOG_LEVEL_CRITICAL + 1];
+uint64_t CAsyncLog::m_nReportedDrops[LOG_LEVEL_CRITICAL + 1];
+std::vector<const LogFormatInfo*> CAsyncLog::m_vecFormats;
+std::mutex CAsyncLog::m_mutexFormats;
+std::vector<const LogFormatInfo*> CAsyncLog::m_vecFormatCache;
+std::vector<bool> CAsyncLog::m_vecFormatInFile;
+std::vector<std::shared_ptr<CAsyncLog::ThreadBuffer>>
+    CAsyncLog::m_vecNewBuffers;
+std::mutex CAsyncLog::m_mutexBuffers;
+std::vector<std::shared_ptr<CAsyncLog::ThreadBuffer>> CAsyncLog::m_vecBuffers;
 std::unique_ptr<std::thread> CAsyncLog::m_spWriteThread;
 std::mutex CAsyncLog::m_mutexWrite;
+std::mutex CAsyncLog::m_mutexFile;
 std::condition_variable CAsyncLog::m_cvWrite;
-bool CAsyncLog::CAsyncLog::m_bExit = false;
-bool CAsyncLog::m_bRunning = false;
+std::atomic<bool> CAsyncLog::m_bWriterSleeping{false};
+std::atomic<bool> CAsyncLog::CAsyncLog::m_bExit{false};
+std::atomic<bool> CAsyncLog::m_bRunning{false};
+
+// 单生产者环形缓冲：所属线程写入，写线程读取。每个槽带一个序号
+// （与 MpmcRing 相同）：等于写入位置时可写，等于写入位置 + 1 时可读。
+// 读位置用 CAS 推进，这样缓冲区满时所属线程也能取走最早的一条丢弃
+class CAsyncLog::ThreadBuffer {
+ public:
+  // bRecord 为 true 时 strLine 是延迟日志的记录，否则是格式化好的一行
+  struct Slot {
+    std::atomic<size_t> nSeq{0};
+    long nLevel = 0;
+    uint64_t nStamp = 0;
+    bool bRecord = false;
+    std::string strLine;
+  };
+
+  // nCapacity 必须是 2 的幂
+  explicit ThreadBuffer(size_t nCapacity)
+      : m_nMask(nCapacity - 1), m_slots(new Slot[nCapacity]) {
+    for (size_t i = 0; i < nCapacity; i++) {
+      m_slots[i].nSeq.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  // 以下只由所属线程调用
+  // 返回可以写入的槽，缓冲区满时按 m_nQueuePolicy 处理。
+  // 丢弃这一条或写线程没有运行时返回 nullptr
+  Slot* waitForSlot(long nLevel) {
+    const bool bMayDrop =
+        nLevel != LOG_LEVEL_CRITICAL && m_nQueuePolicy != LOG_QUEUE_BLOCK;
+    if (bMayDrop && m_nQueuePolicy == LOG_QUEUE_SAMPLE &&
+        m_nTail - m_nHead.load(std::memory_order_relaxed) >=
+            (m_nMask + 1) / 4 * 3 &&
+        ++m_nSampleCount % m_nQueueValue != 0) {
+      countDroppedLine(nLevel);
+      return nullptr;
+    }
+
+    while (true) {
+      Slot& slot = m_slots[m_nTail & m_nMask];
+      if (slot.nSeq.load(std::memory_order_acquire) == m_nTail) return &slot;
+      if (!m_bRunning) {
+        // 没有写线程时等不到空位，和其他策略一样计入丢弃
+        countDroppedLine(nLevel);
+        return nullptr;
+      }
+      if (bMayDrop) {
+        if (m_nQueuePolicy != LOG_QUEUE_DROP_OLDEST) {
+          countDroppedLine(nLevel);
+          return nullptr;
+        }
+        if (dropOldest()) continue;
+      }
+      notifyWriter();
+      std::this_thread::yield();
+    }
+  }
+
+  // 发布 waitForSlot 返回的槽
+  void commit() {
+    m_slots[m_nTail & m_nMask].nSeq.store(m_nTail + 1,
+                                          std::memory_order_release);
+    m_nTail++;
+  }
+
+  // 以下只由写线程调用
+  bool empty() const {
+    const size_t nHead = m_nHead.load(std::memory_order_relaxed);
+    return m_slots[nHead & m_nMask].nSeq.load(std::memory_order_acquire) !=
+           nHead + 1;
+  }
+
+  // 取出当前已写入的全部日志，对每个槽调用 fn(slot)
+  template <typename F>
+  void drain(F&& fn) {
+    size_t nHead = m_nHead.load(std::memory_order_relaxed);
+    while (true) {
+      Slot& slot = m_slots[nHead & m_nMask];
+      const size_t nSeq = slot.nSeq.load(std::memory_order_acquire);
+      if (nSeq != nHead + 1) {
+        // 所属线程可能刚丢弃了最早的日志，读位置已经前移
+        const size_t nNewHead = m_nHead.load(std::memory_order_relaxed);
+        if (nNewHead == nHead) return;
+        nHead = nNewHead;
+        continue;
+      }
+      if (!m_nHead.compare_exchange_weak(nHead, nHead + 1,
+                                         std::memory_order_relaxed)) {
+        continue;
+      }
+      fn(slot);
+      slot.nSeq.store(nHead + m_nMask + 1, std::memory_order_release);
+      nHead++;
+    }
+  }
+
+  // 所属线程已退出，取完剩余日志后即可释放
+  std::atomic<bool> m_bRetired{false};
+
+ private:
+  // 丢弃最早的一条并计数；它是 CRITICAL 日志或已被写线程取走时返回 false
+  bool dropOldest() {
+    size_t nHead = m_nHead.load(std::memory_order_relaxed);
+    Slot& slot = m_slots[nHead & m_nMask];
+    // 只有所属线程写入槽，读 nLevel 不会与写线程冲突
+    if (slot.nSeq.load(std::memory_order_acquire) != nHead + 1 ||
+        slot.nLevel == LOG_LEVEL_CRITICAL ||
+        !m_nHead.compare_exchange_strong(nHead, nHead + 1,
+                                         std::memory_order_relaxed)) {
+      return false;
+    }
+    countDroppedLine(slot.nLevel);
+    slot.nSeq.store(nHead + m_nMask + 1, std::memory_order_release);
+    return true;
+  }
+
+  const size_t m_nMask;
+  std::unique_ptr<Slot[]> m_slots;
+  // 以下两个只由所属线程访问
+  size_t m_nTail = 0;
+  uint64_t m_nSampleCount = 0;
+  alignas(64) std::atomic<size_t> m_nHead{0};
+};
+
+struct CAsyncLog::PendingLine {
+  uint64_t nStamp;
+  bool bRecord;
+  std::string strLine;
+};
+
+namespace {
+uint64_t steadyStamp() {
+  return std::chrono::steady_clock::now().time_since_epoch().count();
+}
+
+uint64_t nowMicros() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::system_clock::now().time_since_epoch())
+      .count();
+}
+
+// 与 std::thread::id 的输出一致，每个线程只计算一次
+uint64_t currentThreadId() {
+  thread_local const uint64_t nThreadId = []() {
+    std::ostringstream osThreadID;
+    osThreadID << std::this_thread::get_id();
+    return std::strtoull(osThreadID.str().c_str(), nullptr, 0);
+  }();
+  return nThreadId;
+}
+}  // namespace
 
 bool CAsyncLog::init(const char* pszLogFileName /* = nullptr*/,
                      bool bTruncateLongLine /* = false*/,
@@ -51,22 +233,32 @@ bool CAsyncLog::init(const char* pszLogFileName /* = nullptr*/,
 
   // TODO：创建文件夹
 
+  m_bExit = false;
   m_spWriteThread.reset(new std::thread(writeThreadProc));
 
   return true;
 }
 
 void CAsyncLog::uninit() {
-  m_bExit = true;
+  {
+    // 在锁内设置，写线程检查退出标志与开始休眠之间不会漏掉通知
+    std::lock_guard<std::mutex> lock(m_mutexWrite);
+    m_bExit = true;
+  }
 
   m_cvWrite.notify_one();
 
-  if (m_spWriteThread->joinable()) m_spWriteThread->join();
+  if (m_spWriteThread && m_spWriteThread->joinable()) m_spWriteThread->join();
+  m_spWriteThread.reset();
 
+  std::lock_guard<std::mutex> lock(m_mutexFile);
   if (m_hLogFile != nullptr) {
     fclose(m_hLogFile);
     m_hLogFile = nullptr;
   }
+  m_mappedFile.close();
+  m_nextMappedFile.discard();
+  m_nUnflushedSize = 0;
 }
 
 void CAsyncLog::setLevel(LOG_LEVEL nLevel) {
@@ -75,6 +267,41 @@ void CAsyncLog::setLevel(LOG_LEVEL nLevel) {
   m_nCurrentLevel = nLevel;
 }
 
+void CAsyncLog::setConsoleEcho(bool bEcho) { m_bConsoleEcho = bEcho; }
+
+void CAsyncLog::setFlushPolicy(LOG_FLUSH_POLICY nPolicy,
+                               int64_t nValue /* = 0*/) {
+  if (nPolicy < LOG_FLUSH_EVERY_LINE || nPolicy > LOG_FLUSH_BYTES) return;
+  if (nPolicy != LOG_FLUSH_EVERY_LINE && nValue <= 0) return;
+
+  m_nFlushPolicy = nPolicy;
+  m_nFlushValue = nValue;
+}
+
+void CAsyncLog::setBinaryFile(bool bBinary) { m_bBinaryFile = bBinary; }
+
+void CAsyncLog::setMappedFile(bool bMapped) { m_bMappedFile = bMapped; }
+
+void CAsyncLog::setQueueCapacity(size_t nLines) {
+  size_t nCapacity = 2;
+  while (nCapacity < nLines) nCapacity *= 2;
+  m_nQueueCapacity = nCapacity;
+}
+
+void CAsyncLog::setQueuePolicy(LOG_QUEUE_POLICY nPolicy,
+                               int64_t nValue /* = 0*/) {
+  if (nPolicy < LOG_QUEUE_BLOCK || nPolicy > LOG_QUEUE_SAMPLE) return;
+  if (nPolicy == LOG_QUEUE_SAMPLE && nValue <= 0) return;
+
+  m_nQueuePolicy = nPolicy;
+  m_nQueueValue = nPolicy == LOG_QUEUE_SAMPLE ? nValue : 1;
+}
+
+uint64_t CAsyncLog::droppedLines(LOG_LEVEL nLevel) {
+  if (nLevel < LOG_LEVEL_TRACE || nLevel > LOG_LEVEL_CRITICAL) return 0;
+  return m_nDroppedLines[nLevel].load(std::memory_order_relaxed);
+}
+
 bool CAsyncLog::isRunning() { return m_bRunning; }
 
 bool CAsyncLog::output(long nLevel, const char* pszFmt, ...) {
@@ -82,85 +309,16 @@ bool CAsyncLog::output(long nLevel, const char* pszFmt, ...) {
     if (nLevel < m_nCurrentLevel) return false;
   }
 
-  std::string strLine;
+  std::string& strLine = lineBuffer();
   makeLinePrefix(nLevel, strLine);
+  const size_t nMessageBegin = strLine.size();
 
   // log正文
-  std::string strLogMsg;
-
-  // 先计算一下不定参数的长度，以便于分配空间
   va_list ap;
   va_start(ap, pszFmt);
-  int nLogMsgLength = vsnprintf(NULL, 0, pszFmt, ap);
+  appendFormat(strLine, pszFmt, ap);
   va_end(ap);
-
-  // 容量必须算上最后一个\0
-  if ((int)strLogMsg.capacity() < nLogMsgLength + 1) {
-    strLogMsg.resize(nLogMsgLength + 1);
-  }
-  va_list aq;
-  va_start(aq, pszFmt);
-  vsnprintf((char*)strLogMsg.data(), strLogMsg.capacity(), pszFmt, aq);
-  va_end(aq);
-
-  // string内容正确但length不对，恢复一下其length
-  std::string strMsgFormal;
-  strMsgFormal.append(strLogMsg.c_str(), nLogMsgLength);
-
-  // 如果日志开启截断，长日志只取前MAX_LINE_LENGTH个字符
-  if (m_bTruncateLongLog)
-    strMsgFormal = strMsgFormal.substr(0, MAX_LINE_LENGTH);
-
-  strLine += strMsgFormal;
-
-  // 不是输出到控制台才会在每一行末尾加一个换行符
-  if (!m_strFileName.empty()) {
-    strLine += "\n";
-  }
-
-  if (nLevel != LOG_LEVEL_FATAL) {
-    std::lock_guard<std::mutex> lock_guard(m_mutexWrite);
-    m_listLinesToWrite.push_back(strLine);
-    m_cvWrite.notify_one();
-  } else {
-    // 为了让FATAL级别的日志能立即crash程序，采取同步写日志的方法
-    std::cout << strLine << std::endl;
-#ifdef _WIN32
-    OutputDebugStringA(strLine.c_str());
-    OutputDebugStringA("\n");
-#endif
-
-    if (!m_strFileName.empty()) {
-      if (m_hLogFile == nullptr) {
-        // 新建文件
-        char szNow[64];
-        time_t now = time(NULL);
-        tm time;
-#ifdef _WIN32
-        localtime_s(&time, &now);
-#else
-        localtime_r(&now, &time);
-#endif
-        strftime(szNow, sizeof(szNow), "%Y%m%d%H%M%S", &time);
-
-        std::string strNewFileName(m_strFileName);
-        strNewFileName += ".";
-        strNewFileName += szNow;
-        strNewFileName += ".";
-        strNewFileName += m_strFileNamePID;
-        strNewFileName += ".log";
-        if (!createNewFile(strNewFileName.c_str())) return false;
-      }  // end inner if
-
-      writeToFile(strLine);
-
-    }  // end outer-if
-
-    // 让程序主动crash掉
-    crash();
-  }
-
-  return true;
+  return outputLine(nLevel, strLine, nMessageBegin);
 }
 
 bool CAsyncLog::output(long nLevel, const char* pszFileName, int nLineNo,
@@ -169,41 +327,56 @@ bool CAsyncLog::output(long nLevel, const char* pszFileName, int nLineNo,
     if (nLevel < m_nCurrentLevel) return false;
   }
 
-  std::string strLine;
+  std::string& strLine = lineBuffer();
   makeLinePrefix(nLevel, strLine);
 
   // 函数签名
   char szFileName[512] = {0};
   snprintf(szFileName, sizeof(szFileName), "[%s:%d]", pszFileName, nLineNo);
   strLine += szFileName;
+  const size_t nMessageBegin = strLine.size();
 
   // 日志正文
-  std::string strLogMsg;
-
-  // 先计算一下不定参数的长度，以便于分配空间
   va_list ap;
   va_start(ap, pszFmt);
-  int nLogMsgLength = vsnprintf(NULL, 0, pszFmt, ap);
+  appendFormat(strLine, pszFmt, ap);
   va_end(ap);
+  return outputLine(nLevel, strLine, nMessageBegin);
+}
 
-  // 容量必须算上最后一个\0
-  if ((int)strLogMsg.capacity() < nLogMsgLength + 1) {
-    strLogMsg.resize(nLogMsgLength + 1);
-  }
+std::string& CAsyncLog::lineBuffer() {
+  thread_local std::string strLine;
+  return strLine;
+}
+
+void CAsyncLog::appendFormat(std::string& strLine, const char* pszFmt,
+                             va_list ap) {
+  // 直接格式化到行缓冲区已有的空间里，放不下时按实际长度扩容再格式化一次
+  const size_t nOldSize = strLine.size();
+  const size_t nSpare =
+      std::max<size_t>(strLine.capacity() - nOldSize, MAX_LINE_LENGTH);
+  strLine.resize(nOldSize + nSpare);
   va_list aq;
-  va_start(aq, pszFmt);
-  vsnprintf((char*)strLogMsg.data(), strLogMsg.capacity(), pszFmt, aq);
+  va_copy(aq, ap);
+  const int nLength = vsnprintf(&strLine[nOldSize], nSpare + 1, pszFmt, aq);
   va_end(aq);
+  if (nLength < 0) {
+    strLine.resize(nOldSize);
+    return;
+  }
+  if (static_cast<size_t>(nLength) > nSpare) {
+    strLine.resize(nOldSize + nLength);
+    vsnprintf(&strLine[nOldSize], nLength + 1, pszFmt, ap);
+  }
+  strLine.resize(nOldSize + nLength);
+}
 
-  // string内容正确但length不对，恢复一下其length
-  std::string strMsgFormal;
-  strMsgFormal.append(strLogMsg.c_str(), nLogMsgLength);
-
+bool CAsyncLog::outputLine(long nLevel, std::string& strLine,
+                           size_t nMessageBegin) {
   // 如果日志开启截断，长日志只取前MAX_LINE_LENGTH个字符
-  if (m_bTruncateLongLog)
-    strMsgFormal = strMsgFormal.substr(0, MAX_LINE_LENGTH);
-
-  strLine += strMsgFormal;
+  if (m_bTruncateLongLog && strLine.size() - nMessageBegin > MAX_LINE_LENGTH) {
+    strLine.resize(nMessageBegin + MAX_LINE_LENGTH);
+  }
 
   // 不是输出到控制台才会在每一行末尾加一个换行符
   if (!m_strFileName.empty()) {
@@ -211,9 +384,7 @@ bool CAsyncLog::output(long nLevel, const char* pszFileName, int nLineNo,
   }
 
   if (nLevel != LOG_LEVEL_FATAL) {
-    std::lock_guard<std::mutex> lock_guard(m_mutexWrite);
-    m_listLinesToWrite.push_back(strLine);
-    m_cvWrite.notify_one();
+    enqueue(nLevel, strLine);
   } else {
     // 为了让FATAL级别的日志能立即crash程序，采取同步写日志的方法
     std::cout << strLine << std::endl;
@@ -223,7 +394,9 @@ bool CAsyncLog::output(long nLevel, const char* pszFileName, int nLineNo,
 #endif
 
     if (!m_strFileName.empty()) {
-      if (m_hLogFile == nullptr) {
+      // 写线程可能正在追加或重新映射同一个文件
+      std::lock_guard<std::mutex> lock(m_mutexFile);
+      if (!hasLogFile()) {
         // 新建文件
         char szNow[64];
         time_t now = time(NULL);
@@ -244,7 +417,15 @@ bool CAsyncLog::output(long nLevel, const char* pszFileName, int nLineNo,
         if (!createNewFile(strNewFileName.c_str())) return false;
       }  // end inner if
 
-      writeToFile(strLine);
+      if (m_bBinaryFile) {
+        std::string strFrame;
+        appendLogFrame(strFrame, LOG_FRAME_TEXT, strLine.data(),
+                       strLine.size());
+        writeToFile(strFrame);
+      } else {
+        writeToFile(strLine);
+      }
+      if (m_hLogFile != nullptr) fflush(m_hLogFile);
     }  // end outer-if
 
     // 让程序主动crash掉
@@ -288,9 +469,7 @@ bool CAsyncLog::outputBinary(unsigned char* buffer, size_t size) {
     }
   }
 
-  std::lock_guard<std::mutex> lock_guard(m_mutexWrite);
-  m_listLinesToWrite.push_back(os.str());
-  m_cvWrite.notify_one();
+  enqueue(LOG_LEVEL_DEBUG, os.str());
 
   return true;
 }
@@ -335,60 +514,30 @@ char* CAsyncLog::formLog(int& index, char* szbuf, size_t size_buf,
 }
 
 void CAsyncLog::makeLinePrefix(long nLevel, std::string& strPrefix) {
-  // 级别
-  strPrefix = "[INFO]";
-  if (nLevel == LOG_LEVEL_TRACE)
-    strPrefix = "[TRACE]";
-  else if (nLevel == LOG_LEVEL_DEBUG)
-    strPrefix = "[DEBUG]";
-  else if (nLevel == LOG_LEVEL_WARNING)
-    strPrefix = "[WARN]";
-  else if (nLevel == LOG_LEVEL_ERROR)
-    strPrefix = "[ERROR]";
-  else if (nLevel == LOG_LEVEL_SYSERROR)
-    strPrefix = "[SYSE]";
-  else if (nLevel == LOG_LEVEL_FATAL)
-    strPrefix = "[FATAL]";
-  else if (nLevel == LOG_LEVEL_CRITICAL)
-    strPrefix = "[CRITICAL]";
-
-  // 时间
-  char szTime[64] = {0};
-  getTime(szTime, sizeof(szTime));
-
-  strPrefix += "[";
-  strPrefix += szTime;
-  strPrefix += "]";
-
-  // 当前线程信息
-  char szThreadID[32] = {0};
-  std::ostringstream osThreadID;
-  osThreadID << std::this_thread::get_id();
-  snprintf(szThreadID, sizeof(szThreadID), "[%s]", osThreadID.str().c_str());
-  strPrefix += szThreadID;
-}
-
-void CAsyncLog::getTime(char* pszTime, int nTimeStrLength) {
-  struct timeb tp;
-  ftime(&tp);
-
-  time_t now = tp.time;
-  tm time;
-#ifdef _WIN32
-  localtime_s(&time, &now);
-#else
-  localtime_r(&now, &time);
-#endif
-
-  snprintf(pszTime, nTimeStrLength, "[%04d-%02d-%02d %02d:%02d:%02d:%03d]",
-           time.tm_year + 1900, time.tm_mon + 1, time.tm_mday, time.tm_hour,
-           time.tm_min, time.tm_sec, tp.millitm);
-  // strftime(pszTime, nTimeStrLength, "[%Y-%m-%d %H:%M:%S:]", &time);
+  strPrefix.clear();
+  appendLogPrefix(strPrefix, nLevel, nowMicros(), currentThreadId());
 }
 
 bool CAsyncLog::createNewFile(const char* pszLogFileName) {
   if (m_hLogFile != nullptr) {
     fclose(m_hLogFile);
+    m_hLogFile = nullptr;
+  }
+
+  if (m_bMappedFile) {
+    m_mappedFile.close();
+    // 有提前建好的文件时只需改名
+    if (m_nextMappedFile.isOpen()) {
+      if (m_nextMappedFile.rename(pszLogFileName)) {
+        m_mappedFile = std::move(m_nextMappedFile);
+        return true;
+      }
+      m_nextMappedFile.discard();
+    }
+    if (m_mappedFile.open(pszLogFileName,
+                          m_nFileRollSize + MAPPED_FILE_SLACK)) {
+      return true;
+    }
   }
 
   // 始终新建文件
@@ -396,90 +545,385 @@ bool CAsyncLog::createNewFile(const char* pszLogFileName) {
   return m_hLogFile != nullptr;
 }
 
+bool CAsyncLog::hasLogFile() {
+  return m_hLogFile != nullptr || m_mappedFile.isOpen();
+}
+
+void CAsyncLog::prepareNextFile() {
+  if (!m_mappedFile.isOpen() || m_nextMappedFile.isOpen() ||
+      m_nCurrentWrittenSize < m_nFileRollSize / 2) {
+    return;
+  }
+  // 正式的文件名含有轮转时的时间，先用临时的名字
+  std::string strNextFileName(m_strFileName);
+  strNextFileName += ".";
+  strNextFileName += m_strFileNamePID;
+  strNextFileName += ".next";
+  m_nextMappedFile.open(strNextFileName, m_nFileRollSize + MAPPED_FILE_SLACK);
+}
+
 bool CAsyncLog::writeToFile(const std::string& data) {
-  // 为了防止长文件一次性写不完，放在一个循环里面分批写
-  std::string strLocal(data);
-  int ret = 0;
-  while (true) {
-    ret = fwrite(strLocal.c_str(), 1, strLocal.length(), m_hLogFile);
-    if (ret <= 0)
-      return false;
-    else if (ret <= (int)strLocal.length()) {
-      strLocal.erase(0, ret);
-    }
+  if (m_mappedFile.isOpen()) {
+    return m_mappedFile.write(data.data(), data.length());
+  }
 
-    if (strLocal.empty()) break;
+  // 为了防止长文件一次性写不完，放在一个循环里面分批写
+  size_t nWritten = 0;
+  while (nWritten < data.length()) {
+    size_t ret = fwrite(data.c_str() + nWritten, 1, data.length() - nWritten,
+                        m_hLogFile);
+    if (ret == 0) return false;
+    nWritten += ret;
   }
 
   //::OutputDebugStringA(strDebugInfo.c_str());
 
-  fflush(m_hLogFile);
+  return true;
+}
 
+bool CAsyncLog::writeBatch(std::string& strBatch, std::string& strBinary) {
+  if (m_bConsoleEcho && !strBatch.empty()) {
+    std::cout.write(strBatch.c_str(), strBatch.length());
+    std::cout.flush();
+  }
+
+  const std::string& strFileBatch = m_bBinaryFile ? strBinary : strBatch;
+  if (!m_strFileName.empty() && !strFileBatch.empty()) {
+    if (!writeToFile(strFileBatch)) return false;
+    m_nUnflushedSize += strFileBatch.length();
+    flushFile(false);
+    prepareNextFile();
+  }
+
+  strBatch.clear();
+  strBinary.clear();
   return true;
 }
 
+void CAsyncLog::flushFile(bool bForce) {
+  if (!hasLogFile() || m_nUnflushedSize == 0) return;
+
+  const auto now = std::chrono::steady_clock::now();
+  bool bDue = bForce;
+  switch (m_nFlushPolicy) {
+    case LOG_FLUSH_EVERY_LINE:
+      bDue = true;
+      break;
+    case LOG_FLUSH_INTERVAL:
+      bDue = bDue || now - m_tpLastFlush >=
+                         std::chrono::milliseconds(m_nFlushValue);
+      break;
+    case LOG_FLUSH_BYTES:
+      bDue = bDue || m_nUnflushedSize >= m_nFlushValue * 1024;
+      break;
+  }
+  if (!bDue) return;
+
+  // 映射文件写入后已经在页缓存中，不需要刷新
+  if (m_hLogFile != nullptr) fflush(m_hLogFile);
+  m_nUnflushedSize = 0;
+  m_tpLastFlush = now;
+}
+
 void CAsyncLog::crash() {
   char* p = nullptr;
   *p = 0;
 }
 
-void CAsyncLog::writeThreadProc() {
-  m_bRunning = true;
+CAsyncLog::ThreadBuffer& CAsyncLog::localBuffer() {
+  // 线程退出时标记缓冲区，写线程取完剩余日志后释放它
+  struct Holder {
+    std::shared_ptr<ThreadBuffer> spBuffer;
+    ~Holder() {
+      if (spBuffer) spBuffer->m_bRetired.store(true, std::memory_order_release);
+    }
+  };
+  thread_local Holder holder;
+
+  if (!holder.spBuffer) {
+    // 每个线程只在第一次输出日志时注册一次
+    holder.spBuffer = std::make_shared<ThreadBuffer>(m_nQueueCapacity);
+    std::lock_guard<std::mutex> lock(m_mutexBuffers);
+    m_vecNewBuffers.push_back(holder.spBuffer);
+  }
+  return *holder.spBuffer;
+}
 
-  while (true) {
-    if (!m_strFileName.empty()) {
-      if (m_hLogFile == nullptr || m_nCurrentWrittenSize >= m_nFileRollSize) {
-        // 重置m_nCurrentWrittenSize大小
-        m_nCurrentWrittenSize = 0;
+void CAsyncLog::enqueue(long nLevel, const std::string& strLine) {
+  const uint64_t nStamp = steadyStamp();
+  ThreadBuffer& buffer = localBuffer();
+  ThreadBuffer::Slot* pSlot = buffer.waitForSlot(nLevel);
+  if (pSlot == nullptr) return;
+
+  // 复制进槽里保留的字符串，容量足够时不分配内存
+  pSlot->nLevel = nLevel;
+  pSlot->nStamp = nStamp;
+  pSlot->bRecord = false;
+  pSlot->strLine = strLine;
+  buffer.commit();
+  notifyWriter();
+}
 
-        // 第一次或者文件大小超过rollsize，均新建文件
-        char szNow[64];
-        time_t now = time(NULL);
-        tm time;
+char* CAsyncLog::beginRecord(long nLevel, uint32_t nFormatId,
+                             size_t nArgsSize) {
+  const uint64_t nStamp = steadyStamp();
+  const uint64_t nTimeUs = nowMicros();
+  const uint64_t nThreadId = currentThreadId();
+  ThreadBuffer::Slot* pSlot = localBuffer().waitForSlot(nLevel);
+  if (pSlot == nullptr) return nullptr;
+
+  // 槽里的字符串保留了容量，稳定后编码不再分配内存
+  pSlot->nLevel = nLevel;
+  pSlot->nStamp = nStamp;
+  pSlot->bRecord = true;
+  pSlot->strLine.resize(kLogRecordHeaderSize + nArgsSize);
+  char* p = pSlot->strLine.data();
+  memcpy(p, &nFormatId, 4);
+  memcpy(p + 4, &nTimeUs, 8);
+  memcpy(p + 12, &nThreadId, 8);
+  return p + kLogRecordHeaderSize;
+}
+
+void CAsyncLog::commitRecord() {
+  localBuffer().commit();
+  notifyWriter();
+}
+
+uint32_t CAsyncLog::registerFormat(const LogFormatInfo* pInfo) {
+  std::lock_guard<std::mutex> lock(m_mutexFormats);
+  m_vecFormats.push_back(pInfo);
+  return static_cast<uint32_t>(m_vecFormats.size() - 1);
+}
+
+const LogFormatInfo* CAsyncLog::lookupFormat(uint32_t nFormatId) {
+  if (nFormatId >= m_vecFormatCache.size()) {
+    std::lock_guard<std::mutex> lock(m_mutexFormats);
+    m_vecFormatCache = m_vecFormats;
+  }
+  return m_vecFormatCache[nFormatId];
+}
+
+void CAsyncLog::notifyWriter() {
+  // 与写线程休眠前的检查配对：要么写线程看到新日志，要么这里看到它准备休眠。
+  // 写线程忙碌时不加锁，只有唤醒休眠的写线程时才需要加锁
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (m_bWriterSleeping.load(std::memory_order_relaxed)) {
+    std::lock_guard<std::mutex> lock(m_mutexWrite);
+    m_cvWrite.notify_one();
+  }
+}
+
+void CAsyncLog::countDroppedLine(long nLevel) {
+  if (nLevel < LOG_LEVEL_TRACE || nLevel > LOG_LEVEL_CRITICAL) {
+    nLevel = LOG_LEVEL_INFO;
+  }
+  m_nDroppedLines[nLevel].fetch_add(1, std::memory_order_relaxed);
+}
+
+void CAsyncLog::appendDropSummary(std::string& strBatch,
+                                  std::string& strBinary) {
+  uint64_t nTotal = 0;
+  std::string strCounts;
+  for (int i = LOG_LEVEL_TRACE; i <= LOG_LEVEL_CRITICAL; i++) {
+    const uint64_t nDropped =
+        m_nDroppedLines[i].load(std::memory_order_relaxed);
+    if (nDropped == m_nReportedDrops[i]) continue;
+    nTotal += nDropped - m_nReportedDrops[i];
+    strCounts += ' ';
+    strCounts += logLevelTag(i);
+    strCounts += std::to_string(nDropped - m_nReportedDrops[i]);
+    m_nReportedDrops[i] = nDropped;
+  }
+  if (nTotal == 0) return;
+
+  PendingLine line{steadyStamp(), false, std::string()};
+  makeLinePrefix(LOG_LEVEL_WARNING, line.strLine);
+  line.strLine += "log queue full, dropped ";
+  line.strLine += std::to_string(nTotal);
+  line.strLine += " lines:";
+  line.strLine += strCounts;
+  if (!m_strFileName.empty()) line.strLine += '\n';
+  appendPendingLine(line, strBatch, strBinary);
+}
+
+bool CAsyncLog::collectLines(std::vector<PendingLine>& lines) {
+  {
+    std::lock_guard<std::mutex> lock(m_mutexBuffers);
+    for (auto& spBuffer : m_vecNewBuffers) {
+      m_vecBuffers.push_back(std::move(spBuffer));
+    }
+    m_vecNewBuffers.clear();
+  }
+
+  for (auto it = m_vecBuffers.begin(); it != m_vecBuffers.end();) {
+    // 先读退出标记再取日志，线程退出前写入的日志这一轮一定能取到
+    const bool bRetired = (*it)->m_bRetired.load(std::memory_order_acquire);
+    // 复制而不是移走，槽里的字符串保留容量供生产者复用
+    (*it)->drain([&lines](const ThreadBuffer::Slot& slot) {
+      lines.push_back(PendingLine{slot.nStamp, slot.bRecord, slot.strLine});
+    });
+    if (bRetired) {
+      it = m_vecBuffers.erase(it);
+    } else {
+      ++it;
+    }
+  }
+
+  // 每个缓冲区内部已按时间排好序，稳定排序即可把各线程的日志合并
+  std::stable_sort(lines.begin(), lines.end(),
+                   [](const PendingLine& lhs, const PendingLine& rhs) {
+                     return lhs.nStamp < rhs.nStamp;
+                   });
+  return !lines.empty();
+}
+
+bool CAsyncLog::rollFileIfNeeded() {
+  if (hasLogFile() && m_nCurrentWrittenSize < m_nFileRollSize) {
+    return true;
+  }
+  // 重置m_nCurrentWrittenSize大小
+  m_nCurrentWrittenSize = 0;
+
+  // 第一次或者文件大小超过rollsize，均新建文件
+  char szNow[64];
+  time_t now = time(NULL);
+  tm time;
 #ifdef _WIN32
-        localtime_s(&time, &now);
+  localtime_s(&time, &now);
 #else
-        localtime_r(&now, &time);
+  localtime_r(&now, &time);
 #endif
-        strftime(szNow, sizeof(szNow), "%Y%m%d%H%M%S", &time);
-
-        std::string strNewFileName(m_strFileName);
-        strNewFileName += ".";
-        strNewFileName += szNow;
-        strNewFileName += ".";
-        strNewFileName += m_strFileNamePID;
-        strNewFileName += ".log";
-        if (!createNewFile(strNewFileName.c_str())) return;
-      }  // end inner if
-    }  // end outer-if
+  strftime(szNow, sizeof(szNow), "%Y%m%d%H%M%S", &time);
+
+  std::string strNewFileName(m_strFileName);
+  strNewFileName += ".";
+  strNewFileName += szNow;
+  strNewFileName += ".";
+  strNewFileName += m_strFileNamePID;
+  strNewFileName += ".log";
+  // 关闭旧文件时已写出所有数据；新文件要重新写入格式定义
+  m_nUnflushedSize = 0;
+  m_vecFormatInFile.assign(m_vecFormatInFile.size(), false);
+  m_tpLastFlush = std::chrono::steady_clock::now();
+  return createNewFile(strNewFileName.c_str());
+}
 
-    std::string strLine;
-    {
-      std::unique_lock<std::mutex> guard(m_mutexWrite);
-      while (m_listLinesToWrite.empty()) {
-        if (m_bExit) return;
+void CAsyncLog::appendPendingLine(const PendingLine& line,
+                                  std::string& strBatch,
+                                  std::string& strBinary) {
+  const bool bToFile = !m_strFileName.empty();
+  const bool bBinaryFile = bToFile && m_bBinaryFile;
+  uint32_t nFormatId = 0;
+  const LogFormatInfo* pInfo = nullptr;
+  if (line.bRecord) {
+    memcpy(&nFormatId, line.strLine.data(), 4);
+    pInfo = lookupFormat(nFormatId);
+  }
 
-        m_cvWrite.wait(guard);
+  if (bBinaryFile) {
+    const size_t nOldSize = strBinary.size();
+    if (line.bRecord) {
+      // 每个文件第一次用到某个格式时先写入它的定义
+      if (nFormatId >= m_vecFormatInFile.size()) {
+        m_vecFormatInFile.resize(nFormatId + 1);
       }
-
-      strLine = m_listLinesToWrite.front();
-      m_listLinesToWrite.pop_front();
+      if (!m_vecFormatInFile[nFormatId]) {
+        appendLogFormatFrame(strBinary, nFormatId, *pInfo);
+        m_vecFormatInFile[nFormatId] = true;
+      }
+      appendLogFrame(strBinary, LOG_FRAME_RECORD, line.strLine.data(),
+                     line.strLine.size());
+    } else {
+      appendLogFrame(strBinary, LOG_FRAME_TEXT, line.strLine.data(),
+                     line.strLine.size());
     }
+    m_nCurrentWrittenSize += strBinary.size() - nOldSize;
+    if (!m_bConsoleEcho) return;
+  }
 
-    std::cout << strLine << std::endl;
+  const size_t nOldSize = strBatch.size();
+  if (line.bRecord) {
+    appendLogRecordText(strBatch, *pInfo, line.strLine.data(),
+                        line.strLine.size());
+    if (bToFile) strBatch += '\n';
+  } else {
+    strBatch += line.strLine;
+  }
+  if (!bBinaryFile) m_nCurrentWrittenSize += strBatch.size() - nOldSize;
+  // 只输出到控制台时日志行末尾没有换行符
+  if (!bToFile) strBatch += '\n';
 
 #ifdef _WIN32
-    OutputDebugStringA(strLine.c_str());
-    OutputDebugStringA("\n");
+  OutputDebugStringA(strBatch.c_str() + nOldSize);
 #endif
+}
 
-    if (!m_strFileName.empty()) {
-      if (!writeToFile(strLine)) return;
+void CAsyncLog::writeThreadProc() {
+  m_bRunning = true;
+
+  // 每一轮取出的日志
+  std::vector<PendingLine> lines;
+  auto hasPending = []() {
+    for (const auto& spBuffer : m_vecBuffers) {
+      if (!spBuffer->empty()) return true;
+    }
+    std::lock_guard<std::mutex> lock(m_mutexBuffers);
+    return !m_vecNewBuffers.empty();
+  };
+
+  // 每一批日志先拼接起来，再一次写出；二进制文件的内容单独拼接
+  std::string strBatch;
+  std::string strBinary;
+  while (true) {
+    // 先读退出标志再取日志：uninit 之前提交的日志一定能在这一轮取到
+    const bool bExit = m_bExit;
+    if (!collectLines(lines)) {
+      // 退出前已经取完所有缓冲区
+      if (bExit) break;
+
+      std::unique_lock<std::mutex> guard(m_mutexWrite);
+      m_bWriterSleeping = true;
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      if (!m_bExit && !hasPending()) {
+        // 按时间刷新时，不能让未刷新的数据一直留在缓冲区里
+        if (m_nFlushPolicy == LOG_FLUSH_INTERVAL && m_nUnflushedSize > 0) {
+          const auto deadline =
+              m_tpLastFlush + std::chrono::milliseconds(m_nFlushValue);
+          m_cvWrite.wait_until(guard, deadline);
+        } else {
+          m_cvWrite.wait(guard);
+        }
+      }
+      m_bWriterSleeping = false;
+      guard.unlock();
+
+      std::lock_guard<std::mutex> lock(m_mutexFile);
+      flushFile(false);
+      continue;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutexFile);
+    for (const PendingLine& line : lines) {
+      // 当前文件写满时，先写出已拼接的部分再换新文件
+      if (!m_strFileName.empty() &&
+          (!hasLogFile() || m_nCurrentWrittenSize >= m_nFileRollSize)) {
+        if (!writeBatch(strBatch, strBinary) || !rollFileIfNeeded()) {
+          m_bRunning = false;
+          return;
+        }
+      }
+
+      appendPendingLine(line, strBatch, strBinary);
+    }
+    lines.clear();
+    appendDropSummary(strBatch, strBinary);
 
-      m_nCurrentWrittenSize += strLine.length();
+    if (!writeBatch(strBatch, strBinary)) {
+      m_bRunning = false;
+      return;
     }
   }  // end outer-while-loop
 
   m_bRunning = false;
 }
-}  // namespace playground
\ No newline at end of file
+}  // namespace playground
@@ -0,0 +1,146 @@
+#include "playground/threading/cpu_topology.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <thread>
+
+#ifdef __linux__
+#include <dirent.h>
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace playground {
+namespace {
+// 进程当前允许运行的 CPU（受 taskset / cgroup cpuset 限制）
+std::vector<unsigned int> allowedCpus() {
+  std::vector<unsigned int> cpus;
+#ifdef __linux__
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+    for (unsigned int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+      if (CPU_ISSET(cpu, &set)) cpus.push_back(cpu);
+    }
+  }
+#endif
+  if (cpus.empty()) {
+    const unsigned int count =
+        std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned int cpu = 0; cpu < count; cpu++) cpus.push_back(cpu);
+  }
+  return cpus;
+}
+
+#ifdef __linux__
+// 返回 sysfs 中的节点编号，升序
+std::vector<unsigned int> sysfsNodes() {
+  std::vector<unsigned int> ids;
+  DIR* dir = opendir("/sys/devices/system/node");
+  if (!dir) return ids;
+  while (dirent* entry = readdir(dir)) {
+    const std::string_view name(entry->d_name);
+    if (name.size() <= 4 || name.substr(0, 4) != "node") continue;
+    const std::string_view digits = name.substr(4);
+    if (!std::all_of(digits.begin(), digits.end(),
+                     [](char c) { return c >= '0' && c <= '9'; })) {
+      continue;
+    }
+    ids.push_back(static_cast<unsigned int>(std::stoul(std::string(digits))));
+  }
+  closedir(dir);
+  std::sort(ids.begin(), ids.end());
+  return ids;
+}
+#endif
+}  // namespace
+
+std::vector<unsigned int> parseCpuList(std::string_view text) {
+  std::vector<unsigned int> cpus;
+  auto readNumber = [&text](unsigned int& value) {
+    size_t i = 0;
+    value = 0;
+    while (i < text.size() && text[i] >= '0' && text[i] <= '9') {
+      value = value * 10 + static_cast<unsigned int>(text[i] - '0');
+      i++;
+    }
+    text.remove_prefix(i);
+    return i > 0;
+  };
+
+  while (!text.empty()) {
+    unsigned int first = 0;
+    if (!readNumber(first)) break;
+    unsigned int last = first;
+    if (!text.empty() && text.front() == '-') {
+      text.remove_prefix(1);
+      if (!readNumber(last) || last < first) break;
+    }
+    for (unsigned int cpu = first; cpu <= last; cpu++) cpus.push_back(cpu);
+    if (text.empty() || text.front() != ',') break;
+    text.remove_prefix(1);
+  }
+  return cpus;
+}
+
+CpuTopology CpuTopology::detect() {
+  const std::vector<unsigned int> allowed = allowedCpus();
+  CpuTopology topology;
+#ifdef __linux__
+  for (unsigned int id : sysfsNodes()) {
+    std::ifstream file("/sys/devices/system/node/node" + std::to_string(id) +
+                       "/cpulist");
+    const std::string text((std::istreambuf_iterator<char>(file)),
+                           std::istreambuf_iterator<char>());
+    // 只保留本进程可用的 CPU，没有可用 CPU 的节点（如纯内存节点）跳过
+    std::vector<unsigned int> cpus;
+    for (unsigned int cpu : parseCpuList(text)) {
+      if (std::binary_search(allowed.begin(), allowed.end(), cpu)) {
+        cpus.push_back(cpu);
+      }
+    }
+    if (!cpus.empty()) topology.nodes.push_back(std::move(cpus));
+  }
+#endif
+  if (topology.nodes.empty()) topology.nodes.push_back(allowed);
+  return topology;
+}
+
+unsigned int CpuTopology::nodeOf(unsigned int cpu) const {
+  for (size_t node = 0; node < nodes.size(); node++) {
+    if (std::binary_search(nodes[node].begin(), nodes[node].end(), cpu)) {
+      return static_cast<unsigned int>(node);
+    }
+  }
+  return 0;
+}
+
+size_t CpuTopology::cpuCount() const {
+  size_t count = 0;
+  for (const auto& cpus : nodes) count += cpus.size();
+  return count;
+}
+
+bool pinCurrentThread(unsigned int cpu) {
+#ifdef __linux__
+  if (cpu >= CPU_SETSIZE) return false;
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+  (void)cpu;
+  return false;
+#endif
+}
+
+int currentCpu() {
+#ifdef __linux__
+  return sched_getcpu();
+#else
+  return -1;
+#endif
+}
+}  // namespace playground
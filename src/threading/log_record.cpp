@@ -0,0 +1,381 @@
+#include "playground/threading/log_record.h"
+
+#include <stdio.h>
+#include <time.h>
+
+#include <iterator>
+#include <stdexcept>
+#include <string_view>
+
+#include "playground/threading/async_log.h"
+
+namespace playground {
+namespace {
+struct LogArg {
+  uint8_t nType = 0;
+  uint64_t nBits = 0;
+  const char* pStr = nullptr;
+  uint32_t nLength = 0;
+};
+
+// 按顺序读取编码后的参数
+class LogArgReader {
+ public:
+  LogArgReader(const char* pData, size_t nSize)
+      : m_p(pData), m_pEnd(pData + nSize) {}
+
+  // 没有更多参数或数据不完整时返回 false
+  bool next(LogArg& arg) {
+    if (m_p == m_pEnd) return false;
+    arg.nType = static_cast<uint8_t>(*m_p++);
+    if (arg.nType == LOG_ARG_STRING) {
+      if (m_pEnd - m_p < 4) return false;
+      memcpy(&arg.nLength, m_p, 4);
+      m_p += 4;
+      if (static_cast<size_t>(m_pEnd - m_p) < arg.nLength) return false;
+      arg.pStr = m_p;
+      m_p += arg.nLength;
+    } else {
+      if (m_pEnd - m_p < 8) return false;
+      memcpy(&arg.nBits, m_p, 8);
+      m_p += 8;
+    }
+    return true;
+  }
+
+ private:
+  const char* m_p;
+  const char* m_pEnd;
+};
+
+bool isIntArg(const LogArg& arg) {
+  return arg.nType == LOG_ARG_INT32 || arg.nType == LOG_ARG_INT64 ||
+         arg.nType == LOG_ARG_UINT32 || arg.nType == LOG_ARG_UINT64;
+}
+
+template <typename T>
+void appendFormatted(std::string& strOut, const std::string& strSpec,
+                     T value) {
+  char szBuf[64];
+  const int n = snprintf(szBuf, sizeof(szBuf), strSpec.c_str(), value);
+  if (n < 0) return;
+  if (n < static_cast<int>(sizeof(szBuf))) {
+    strOut.append(szBuf, n);
+    return;
+  }
+  const size_t nOld = strOut.size();
+  strOut.resize(nOld + n + 1);
+  snprintf(&strOut[nOld], n + 1, strSpec.c_str(), value);
+  strOut.resize(nOld + n);
+}
+
+// strSpec 是去掉长度修饰后的 "%[flags][width][.precision]"
+bool appendArg(std::string& strOut, const std::string& strSpec, char cConv,
+               const LogArg& arg) {
+  switch (cConv) {
+    case 'd':
+    case 'i': {
+      if (!isIntArg(arg)) return false;
+      // 与 printf 一样按参数原来的宽度解释
+      const bool bWide =
+          arg.nType == LOG_ARG_INT64 || arg.nType == LOG_ARG_UINT64;
+      const long long nValue =
+          bWide ? static_cast<long long>(arg.nBits)
+                : static_cast<int32_t>(static_cast<uint32_t>(arg.nBits));
+      appendFormatted(strOut, strSpec + "lld", nValue);
+      return true;
+    }
+    case 'u':
+    case 'o':
+    case 'x':
+    case 'X': {
+      if (!isIntArg(arg)) return false;
+      const bool bWide =
+          arg.nType == LOG_ARG_INT64 || arg.nType == LOG_ARG_UINT64;
+      const unsigned long long nValue =
+          bWide ? arg.nBits : static_cast<uint32_t>(arg.nBits);
+      appendFormatted(strOut, strSpec + "ll" + cConv, nValue);
+      return true;
+    }
+    case 'c':
+      if (!isIntArg(arg)) return false;
+      appendFormatted(strOut, strSpec + 'c', static_cast<int>(arg.nBits));
+      return true;
+    case 'f':
+    case 'F':
+    case 'e':
+    case 'E':
+    case 'g':
+    case 'G':
+    case 'a':
+    case 'A': {
+      if (arg.nType != LOG_ARG_DOUBLE) return false;
+      double dValue;
+      memcpy(&dValue, &arg.nBits, 8);
+      appendFormatted(strOut, strSpec + cConv, dValue);
+      return true;
+    }
+    case 's':
+      if (arg.nType != LOG_ARG_STRING) return false;
+      appendFormatted(strOut, strSpec + 's',
+                      std::string(arg.pStr, arg.nLength).c_str());
+      return true;
+    case 'p':
+      if (arg.nType != LOG_ARG_POINTER) return false;
+      appendFormatted(strOut, strSpec + 'p',
+                      reinterpret_cast<void*>(arg.nBits));
+      return true;
+    default:
+      return false;
+  }
+}
+
+// 前缀中的级别标记，按 LOG_LEVEL 索引
+constexpr std::string_view kLevelTags[] = {
+    "[TRACE]", "[DEBUG]", "[INFO]",  "[WARN]",
+    "[ERROR]", "[SYSE]",  "[FATAL]", "[CRITICAL]"};
+static_assert(std::size(kLevelTags) == LOG_LEVEL_CRITICAL + 1);
+
+// 每个线程缓存上一次格式化的秒和线程号：同一秒内只改写毫秒，
+// 线程号不变时直接复用，前缀只剩几次内存复制
+struct LogPrefixCache {
+  int64_t nSecond = -1;
+  char szTime[48];  // [[YYYY-MM-DD HH:MM:SS:mmm]]
+  size_t nTimeLength = 0;
+  bool bHasThreadId = false;
+  uint64_t nThreadId = 0;
+  char szThreadId[24];  // [线程号]
+  size_t nThreadIdLength = 0;
+};
+uint32_t readU32(const char* p) {
+  uint32_t n;
+  memcpy(&n, p, 4);
+  return n;
+}
+
+uint64_t readU64(const char* p) {
+  uint64_t n;
+  memcpy(&n, p, 8);
+  return n;
+}
+}  // namespace
+
+std::string_view logLevelTag(long nLevel) {
+  if (nLevel < 0 || nLevel > LOG_LEVEL_CRITICAL) {
+    return kLevelTags[LOG_LEVEL_INFO];
+  }
+  return kLevelTags[nLevel];
+}
+
+void formatLogArgs(const char* pszFmt, const char* pArgs, size_t nSize,
+                   std::string& strOut) {
+  LogArgReader reader(pArgs, nSize);
+  const char* p = pszFmt;
+  while (*p != '\0') {
+    if (*p != '%') {
+      const char* pNext = strchr(p, '%');
+      if (pNext == nullptr) pNext = p + strlen(p);
+      strOut.append(p, pNext - p);
+      p = pNext;
+      continue;
+    }
+    if (p[1] == '%') {
+      strOut += '%';
+      p += 2;
+      continue;
+    }
+
+    // %[flags][width][.precision][length]conversion
+    const char* pSpecBegin = p++;
+    std::string strSpec = "%";
+    bool bOk = true;
+    LogArg arg;
+    while (*p != '\0' && strchr("-+ #0", *p) != nullptr) strSpec += *p++;
+    if (*p == '*') {
+      p++;
+      bOk = reader.next(arg) && isIntArg(arg);
+      if (bOk) strSpec += std::to_string(static_cast<int>(arg.nBits));
+    } else {
+      while (*p >= '0' && *p <= '9') strSpec += *p++;
+    }
+    if (*p == '.') {
+      p++;
+      if (*p == '*') {
+        p++;
+        bOk = reader.next(arg) && isIntArg(arg) && bOk;
+        // 负的精度等同于没有指定精度
+        if (bOk && static_cast<int>(arg.nBits) >= 0) {
+          strSpec += '.' + std::to_string(static_cast<int>(arg.nBits));
+        }
+      } else {
+        strSpec += '.';
+        while (*p >= '0' && *p <= '9') strSpec += *p++;
+      }
+    }
+    // 长度修饰由参数的实际类型决定
+    while (*p != '\0' && strchr("hljztL", *p) != nullptr) p++;
+    if (*p == '\0') {
+      strOut.append(pSpecBegin, p - pSpecBegin);
+      break;
+    }
+
+    const char cConv = *p++;
+    if (cConv == 'n') {
+      reader.next(arg);
+      continue;
+    }
+    if (!bOk || !reader.next(arg) ||
+        !appendArg(strOut, strSpec, cConv, arg)) {
+      strOut += "<?>";
+    }
+  }
+}
+
+void appendLogPrefix(std::string& strOut, long nLevel, uint64_t nTimeUs,
+                     uint64_t nThreadId) {
+  thread_local LogPrefixCache cache;
+
+  const int64_t nSecond = static_cast<int64_t>(nTimeUs / 1000000);
+  if (nSecond != cache.nSecond) {
+    const time_t now = static_cast<time_t>(nSecond);
+    tm time;
+#ifdef _WIN32
+    localtime_s(&time, &now);
+#else
+    localtime_r(&now, &time);
+#endif
+    cache.nTimeLength = snprintf(
+        cache.szTime, sizeof(cache.szTime),
+        "[[%04d-%02d-%02d %02d:%02d:%02d:000]]", time.tm_year + 1900,
+        time.tm_mon + 1, time.tm_mday, time.tm_hour, time.tm_min, time.tm_sec);
+    cache.nSecond = nSecond;
+  }
+  // 毫秒是 "]]" 之前的三位数字
+  const unsigned int nMillis = static_cast<unsigned int>(nTimeUs / 1000 % 1000);
+  char* pMillis = cache.szTime + cache.nTimeLength - 5;
+  pMillis[0] = static_cast<char>('0' + nMillis / 100);
+  pMillis[1] = static_cast<char>('0' + nMillis / 10 % 10);
+  pMillis[2] = static_cast<char>('0' + nMillis % 10);
+
+  if (!cache.bHasThreadId || nThreadId != cache.nThreadId) {
+    cache.nThreadIdLength =
+        snprintf(cache.szThreadId, sizeof(cache.szThreadId), "[%llu]",
+                 static_cast<unsigned long long>(nThreadId));
+    cache.nThreadId = nThreadId;
+    cache.bHasThreadId = true;
+  }
+
+  const std::string_view tag = logLevelTag(nLevel);
+  strOut.reserve(strOut.size() + tag.size() + cache.nTimeLength +
+                 cache.nThreadIdLength);
+  strOut.append(tag.data(), tag.size());
+  strOut.append(cache.szTime, cache.nTimeLength);
+  strOut.append(cache.szThreadId, cache.nThreadIdLength);
+}
+
+void appendLogRecordText(std::string& strOut, const LogFormatInfo& info,
+                         const char* pRecord, size_t nSize) {
+  if (nSize < kLogRecordHeaderSize) {
+    strOut += "<?>";
+    return;
+  }
+  appendLogPrefix(strOut, info.nLevel, readU64(pRecord + 4),
+                  readU64(pRecord + 12));
+  strOut += '[';
+  strOut += info.pszFile;
+  strOut += ':';
+  strOut += std::to_string(info.nLine);
+  strOut += ']';
+  formatLogArgs(info.pszFmt, pRecord + kLogRecordHeaderSize,
+                nSize - kLogRecordHeaderSize, strOut);
+}
+
+void appendLogFrame(std::string& strOut, LOG_FRAME_TYPE nType,
+                    const char* pData, size_t nSize) {
+  const uint32_t nLength = static_cast<uint32_t>(nSize);
+  strOut += static_cast<char>(nType);
+  strOut.append(reinterpret_cast<const char*>(&nLength), 4);
+  strOut.append(pData, nSize);
+}
+
+void appendLogFormatFrame(std::string& strOut, uint32_t nFormatId,
+                          const LogFormatInfo& info) {
+  std::string strPayload;
+  const int32_t nLevel = static_cast<int32_t>(info.nLevel);
+  const int32_t nLine = info.nLine;
+  strPayload.append(reinterpret_cast<const char*>(&nFormatId), 4);
+  strPayload.append(reinterpret_cast<const char*>(&nLevel), 4);
+  strPayload.append(reinterpret_cast<const char*>(&nLine), 4);
+  strPayload.append(info.pszFile, strlen(info.pszFile) + 1);
+  strPayload.append(info.pszFmt, strlen(info.pszFmt) + 1);
+  appendLogFrame(strOut, LOG_FRAME_FORMAT, strPayload.data(),
+                 strPayload.size());
+}
+
+size_t LogDecoder::decode(const char* pData, size_t nSize,
+                          std::string& strOut) {
+  size_t nPos = 0;
+  while (nPos < nSize) {
+    const char cType = pData[nPos];
+    // 映射文件在程序崩溃后保留了预分配的部分，帧类型为 0 表示后面都是填充
+    if (cType == 0) return nSize;
+    if (nSize - nPos < 5) break;
+    const uint32_t nLength = readU32(pData + nPos + 1);
+    if (nSize - nPos - 5 < nLength) break;
+    const char* pFrame = pData + nPos + 5;
+
+    switch (cType) {
+      case LOG_FRAME_TEXT:
+        strOut.append(pFrame, nLength);
+        break;
+      case LOG_FRAME_FORMAT: {
+        // 文件名和格式串都以 \0 结尾
+        const char* pEnd = pFrame + nLength;
+        const char* pFile = pFrame + 12;
+        const char* pFileEnd =
+            nLength > 12 ? static_cast<const char*>(
+                               memchr(pFile, '\0', pEnd - pFile))
+                         : nullptr;
+        const char* pFmtEnd =
+            pFileEnd != nullptr ? static_cast<const char*>(memchr(
+                                      pFileEnd + 1, '\0', pEnd - pFileEnd - 1))
+                                : nullptr;
+        if (pFmtEnd == nullptr) {
+          throw std::runtime_error("corrupt log format frame");
+        }
+        const uint32_t nFormatId = readU32(pFrame);
+        if (nFormatId >= m_vecFormats.size()) {
+          m_vecFormats.resize(nFormatId + 1);
+        }
+        Format& format = m_vecFormats[nFormatId];
+        format.bValid = true;
+        format.nLevel = static_cast<int32_t>(readU32(pFrame + 4));
+        format.nLine = static_cast<int32_t>(readU32(pFrame + 8));
+        format.strFile.assign(pFile, pFileEnd);
+        format.strFmt.assign(pFileEnd + 1, pFmtEnd);
+        break;
+      }
+      case LOG_FRAME_RECORD: {
+        if (nLength < kLogRecordHeaderSize) {
+          throw std::runtime_error("corrupt log record frame");
+        }
+        const uint32_t nFormatId = readU32(pFrame);
+        if (nFormatId >= m_vecFormats.size() ||
+            !m_vecFormats[nFormatId].bValid) {
+          throw std::runtime_error("log record references unknown format");
+        }
+        const Format& format = m_vecFormats[nFormatId];
+        const LogFormatInfo info{format.nLevel, format.strFile.c_str(),
+                                 format.nLine, format.strFmt.c_str()};
+        appendLogRecordText(strOut, info, pFrame, nLength);
+        strOut += '\n';
+        break;
+      }
+      default:
+        throw std::runtime_error("unknown log frame type");
+    }
+    nPos += 5 + nLength;
+  }
+  return nPos;
+}
+}  // namespace playground
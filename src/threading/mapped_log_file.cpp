@@ -0,0 +1,123 @@
+#include "playground/threading/mapped_log_file.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+#include <utility>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace playground {
+MappedLogFile::~MappedLogFile() { close(); }
+
+MappedLogFile::MappedLogFile(MappedLogFile&& rhs) noexcept
+    : m_nFd(std::exchange(rhs.m_nFd, -1)),
+      m_pData(std::exchange(rhs.m_pData, nullptr)),
+      m_nCapacity(std::exchange(rhs.m_nCapacity, 0)),
+      m_nSize(std::exchange(rhs.m_nSize, 0)),
+      m_strPath(std::move(rhs.m_strPath)) {}
+
+MappedLogFile& MappedLogFile::operator=(MappedLogFile&& rhs) noexcept {
+  if (this != &rhs) {
+    close();
+    m_nFd = std::exchange(rhs.m_nFd, -1);
+    m_pData = std::exchange(rhs.m_pData, nullptr);
+    m_nCapacity = std::exchange(rhs.m_nCapacity, 0);
+    m_nSize = std::exchange(rhs.m_nSize, 0);
+    m_strPath = std::move(rhs.m_strPath);
+  }
+  return *this;
+}
+
+bool MappedLogFile::open(const std::string& strPath, size_t nCapacity) {
+  close();
+#ifdef _WIN32
+  (void)strPath;
+  (void)nCapacity;
+  return false;
+#else
+  m_nFd = ::open(strPath.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC,
+                 0666);
+  if (m_nFd < 0) return false;
+  m_strPath = strPath;
+  // mmap 不接受长度 0
+  if (!grow(std::max<size_t>(nCapacity, 1))) {
+    discard();
+    return false;
+  }
+  return true;
+#endif
+}
+
+bool MappedLogFile::write(const char* pData, size_t nSize) {
+  if (!isOpen()) return false;
+  if (nSize > m_nCapacity - m_nSize &&
+      !grow(std::max(m_nSize + nSize, m_nCapacity * 2))) {
+    return false;
+  }
+  memcpy(m_pData + m_nSize, pData, nSize);
+  m_nSize += nSize;
+  return true;
+}
+
+bool MappedLogFile::rename(const std::string& strPath) {
+  if (!isOpen() || ::rename(m_strPath.c_str(), strPath.c_str()) != 0) {
+    return false;
+  }
+  m_strPath = strPath;
+  return true;
+}
+
+void MappedLogFile::close() {
+  if (m_nFd < 0) return;
+  release();
+#ifndef _WIN32
+  // 去掉预分配但没有用到的部分。失败时文件末尾多出一些 0，不影响已写入的日志
+  const int nResult = ::ftruncate(m_nFd, static_cast<off_t>(m_nSize));
+  (void)nResult;
+  ::close(m_nFd);
+#endif
+  m_nFd = -1;
+  m_nSize = 0;
+  m_strPath.clear();
+}
+
+void MappedLogFile::discard() {
+  if (m_nFd < 0) return;
+  const std::string strPath = m_strPath;
+  close();
+  ::remove(strPath.c_str());
+}
+
+bool MappedLogFile::grow(size_t nCapacity) {
+#ifdef _WIN32
+  (void)nCapacity;
+  return false;
+#else
+  // 先分配磁盘空间：映射区域超出文件实际占用时，磁盘写满会以 SIGBUS 结束程序
+  if (::posix_fallocate(m_nFd, 0, static_cast<off_t>(nCapacity)) != 0) {
+    return false;
+  }
+  void* pData =
+      ::mmap(nullptr, nCapacity, PROT_READ | PROT_WRITE, MAP_SHARED, m_nFd, 0);
+  if (pData == MAP_FAILED) return false;
+  if (m_pData != nullptr) ::munmap(m_pData, m_nCapacity);
+  m_pData = static_cast<char*>(pData);
+  m_nCapacity = nCapacity;
+  return true;
+#endif
+}
+
+void MappedLogFile::release() {
+#ifndef _WIN32
+  if (m_pData != nullptr) ::munmap(m_pData, m_nCapacity);
+#endif
+  m_pData = nullptr;
+  m_nCapacity = 0;
+}
+}  // namespace playground
@@ -0,0 +1,82 @@
+#include "playground/threading/strand.h"
+
+#include <iostream>
+#include <stdexcept>
+
+namespace playground {
+Strand::Strand(ThreadPool& pool, TaskPriority priority)
+    : state_(std::make_shared<State>(pool, priority)) {}
+
+void Strand::post(InplaceTask task) {
+  {
+    std::lock_guard<std::mutex> lock(state_->mtx);
+    state_->pending.push_back(std::move(task));
+    // 已有批次在执行时，新任务会被它在结束前取走
+    if (state_->scheduled) return;
+    state_->scheduled = true;
+  }
+  auto state = state_;
+  try {
+    state->pool.execute([state] { runBatches(state); }, state->priority);
+  } catch (const std::logic_error&) {
+    // 线程池已停止：丢弃积压的任务（future 得到 broken_promise）并报告给提交者
+    RingDeque<InplaceTask> dropped;
+    {
+      std::lock_guard<std::mutex> lock(state->mtx);
+      dropped.swap(state->pending);
+      state->scheduled = false;
+    }
+    throw;
+  } catch (...) {
+    // 队列暂时已满（OverflowPolicy::kReject）等：只拒绝本次提交。
+    // 调度前 pending 为空，本次的任务一定在最前面；
+    // 期间其他线程追加的任务已被告知提交成功，在当前线程执行掉
+    InplaceTask rejected;
+    bool others = false;
+    {
+      std::lock_guard<std::mutex> lock(state->mtx);
+      rejected = std::move(state->pending.front());
+      state->pending.pop_front();
+      others = !state->pending.empty();
+      if (!others) state->scheduled = false;
+    }
+    if (others) runBatches(state);
+    throw;
+  }
+}
+
+void Strand::runBatches(const std::shared_ptr<State>& state) {
+  while (true) {
+    {
+      std::lock_guard<std::mutex> lock(state->mtx);
+      state->running.swap(state->pending);
+    }
+    while (!state->running.empty()) {
+      try {
+        state->running.front()();
+      } catch (std::exception& e) {
+        std::cerr << "Strand task exception:" << e.what() << std::endl;
+      } catch (...) {
+        std::cerr << "Strand task exception: unknown" << std::endl;
+      }
+      state->running.pop_front();
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(state->mtx);
+      if (state->pending.empty()) {
+        state->scheduled = false;
+        return;
+      }
+    }
+    // 还有新任务：重新排队，让其他 strand 和普通任务也有机会执行。
+    // 线程池已停止或队列已满时无法重新排队，在当前线程继续执行，
+    // 不能让 scheduled 停留在 true 而没有池任务来执行
+    try {
+      state->pool.execute([state] { runBatches(state); }, state->priority);
+      return;
+    } catch (...) {
+    }
+  }
+}
+}  // namespace playground
@@ -0,0 +1,83 @@
+#include "playground/threading/task_future.h"
+
+namespace playground {
+namespace {
+constexpr std::uint64_t makeHead(std::uint64_t head, std::uint32_t index) {
+  // 每次修改链表头都递增版本号
+  return (((head >> 32) + 1) << 32) | index;
+}
+}  // namespace
+
+TaskStateSlab::~TaskStateSlab() {
+  for (std::uint32_t i = 0; i < chunk_count_; i++) {
+    delete chunks_[i].load(std::memory_order_relaxed);
+  }
+}
+
+std::uint32_t TaskStateSlab::allocate() {
+  std::uint64_t head = head_.load(std::memory_order_acquire);
+  while (true) {
+    const auto index = static_cast<std::uint32_t>(head);
+    if (index == kNoBlock) {
+      if (!grow()) return kNoBlock;
+      head = head_.load(std::memory_order_acquire);
+      continue;
+    }
+    // chunk 在回收池析构前不会释放，即使该块刚被其他线程取走，读取 next 也是安全的；
+    // 读到的旧值会因为版本号不匹配而使 CAS 失败
+    const std::uint32_t next = nextOf(index).load(std::memory_order_relaxed);
+    if (head_.compare_exchange_weak(head, makeHead(head, next),
+                                    std::memory_order_acquire,
+                                    std::memory_order_acquire)) {
+      refs_.fetch_add(1, std::memory_order_relaxed);
+      return index;
+    }
+  }
+}
+
+void TaskStateSlab::deallocate(std::uint32_t index) {
+  std::uint64_t head = head_.load(std::memory_order_relaxed);
+  do {
+    nextOf(index).store(static_cast<std::uint32_t>(head),
+                        std::memory_order_relaxed);
+  } while (!head_.compare_exchange_weak(head, makeHead(head, index),
+                                        std::memory_order_release,
+                                        std::memory_order_relaxed));
+  unref();
+}
+
+void TaskStateSlab::release() { unref(); }
+
+void TaskStateSlab::unref() {
+  if (refs_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    delete this;
+  }
+}
+
+bool TaskStateSlab::grow() {
+  std::lock_guard<std::mutex> lock(grow_mtx_);
+  // 等锁期间可能已有其他线程扩容或归还了块
+  if (static_cast<std::uint32_t>(head_.load(std::memory_order_acquire)) !=
+      kNoBlock) {
+    return true;
+  }
+  if (chunk_count_ == kMaxChunks) return false;
+
+  const std::uint32_t base = chunk_count_ * kBlocksPerChunk;
+  Chunk* chunk = new Chunk();
+  for (std::uint32_t i = 0; i + 1 < kBlocksPerChunk; i++) {
+    chunk->next[i].store(base + i + 1, std::memory_order_relaxed);
+  }
+  chunks_[chunk_count_++].store(chunk, std::memory_order_release);
+
+  // 把整条新链表挂到当前链表头前面
+  std::uint64_t head = head_.load(std::memory_order_relaxed);
+  do {
+    chunk->next[kBlocksPerChunk - 1].store(static_cast<std::uint32_t>(head),
+                                           std::memory_order_relaxed);
+  } while (!head_.compare_exchange_weak(head, makeHead(head, base),
+                                        std::memory_order_release,
+                                        std::memory_order_relaxed));
+  return true;
+}
+}  // namespace playground
@@ -0,0 +1,94 @@
+#include "playground/threading/task_graph.h"
+
+#include <stdexcept>
+
+namespace playground {
+void TaskGraph::precede(NodeId before, NodeId after) {
+  if (before >= nodes_.size() || after >= nodes_.size()) {
+    throw std::out_of_range("Task graph node does not exist!");
+  }
+  nodes_[before]->successors.push_back(after);
+  nodes_[after]->predecessors++;
+}
+
+BatchHandle TaskGraph::run(ThreadPool& pool, TaskPriority priority) {
+  checkAcyclic();
+  auto state = std::make_shared<BatchHandle::State>(nodes_.size());
+  for (auto& node : nodes_) {
+    node->pending.store(node->predecessors, std::memory_order_relaxed);
+  }
+  // 只有第一个根节点的提交失败时向调用者抛出，此时还没有任务被提交。
+  // 之后的根节点提交失败（线程池被停止、队列已满）时在当前线程执行，
+  // 已排队的任务引用着本图，不能再让调用者收到异常
+  bool queued = false;
+  for (NodeId id = 0; id < nodes_.size(); id++) {
+    if (nodes_[id]->predecessors != 0) continue;
+    if (queued) {
+      schedule(pool, priority, id, state);
+      continue;
+    }
+    pool.execute(
+        [this, &pool, priority, id, state] {
+          runNode(pool, priority, id, state);
+        },
+        priority);
+    queued = true;
+  }
+  return BatchHandle(std::move(state));
+}
+
+void TaskGraph::checkAcyclic() const {
+  // Kahn 拓扑排序：能按入度归零的顺序访问到所有节点即无环
+  std::vector<unsigned int> indegree(nodes_.size());
+  std::vector<NodeId> ready;
+  for (NodeId id = 0; id < nodes_.size(); id++) {
+    indegree[id] = nodes_[id]->predecessors;
+    if (indegree[id] == 0) ready.push_back(id);
+  }
+  size_t visited = 0;
+  while (!ready.empty()) {
+    const NodeId id = ready.back();
+    ready.pop_back();
+    visited++;
+    for (NodeId next : nodes_[id]->successors) {
+      if (--indegree[next] == 0) ready.push_back(next);
+    }
+  }
+  if (visited != nodes_.size()) {
+    throw std::logic_error("Task graph has a cycle!");
+  }
+}
+
+void TaskGraph::schedule(ThreadPool& pool, TaskPriority priority, NodeId id,
+                         const StatePtr& state) {
+  try {
+    pool.execute(
+        [this, &pool, priority, id, state] {
+          runNode(pool, priority, id, state);
+        },
+        priority);
+  } catch (...) {
+    // 执行途中线程池被停止或队列已满：在当前线程上直接执行，保证句柄最终完成
+    runNode(pool, priority, id, state);
+  }
+}
+
+void TaskGraph::runNode(ThreadPool& pool, TaskPriority priority, NodeId id,
+                        const StatePtr& state) {
+  Node& node = *nodes_[id];
+  if (!state->failed.load(std::memory_order_relaxed)) {
+    try {
+      node.work();
+    } catch (...) {
+      state->fail(std::current_exception());
+    }
+  }
+  // 最后一个完成的前驱负责提交后继
+  for (NodeId next : node.successors) {
+    if (nodes_[next]->pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      schedule(pool, priority, next, state);
+    }
+  }
+  state->finish();
+}
+}  // namespace playground
@@ -1,9 +1,71 @@
 #include "playground/threading/thread_pool.h"
 
+#include <bit>
 #include <iostream>
+#include <stdexcept>
+
+#include "playground/threading/cpu_topology.h"
 
 namespace playground {
-ThreadPool::ThreadPool(unsigned int num) {
+bool BatchHandle::done() const {
+  return !state_ || state_->remaining.load(std::memory_order_acquire) == 0;
+}
+
+void BatchHandle::wait() const {
+  if (!state_) return;
+  size_t remaining;
+  while ((remaining = state_->remaining.load(std::memory_order_acquire)) !=
+         0) {
+    state_->remaining.wait(remaining, std::memory_order_acquire);
+  }
+  if (state_->error) std::rethrow_exception(state_->error);
+}
+
+void BatchHandle::State::finish(size_t count) {
+  if (remaining.fetch_sub(count, std::memory_order_acq_rel) == count) {
+    remaining.notify_all();
+  }
+}
+
+void BatchHandle::State::fail(std::exception_ptr e) {
+  // 只保留第一个异常，写入发生在 finish() 的 release 之前
+  if (!failed.exchange(true, std::memory_order_relaxed)) {
+    error = std::move(e);
+  }
+}
+
+unsigned int LatencyHistogram::bucketOf(std::uint64_t ns) {
+  const auto bucket = static_cast<unsigned int>(std::bit_width(ns));
+  return bucket < kBuckets ? bucket : kBuckets - 1;
+}
+
+std::uint64_t LatencyHistogram::total() const {
+  std::uint64_t sum = 0;
+  for (std::uint64_t count : counts) sum += count;
+  return sum;
+}
+
+std::chrono::nanoseconds LatencyHistogram::percentile(double p) const {
+  const std::uint64_t samples = total();
+  if (samples == 0) return std::chrono::nanoseconds(0);
+  // 至少覆盖 1 个样本，p = 0 时返回最小非空桶
+  auto rank = static_cast<std::uint64_t>(p * static_cast<double>(samples));
+  if (rank == 0) rank = 1;
+  if (rank > samples) rank = samples;
+  std::uint64_t seen = 0;
+  unsigned int bucket = 0;
+  for (; bucket < kBuckets; bucket++) {
+    seen += counts[bucket];
+    if (seen >= rank) break;
+  }
+  return std::chrono::nanoseconds(bucket == 0 ? 0 : (1ull << bucket) - 1);
+}
+
+thread_local ThreadPool* ThreadPool::tls_pool_ = nullptr;
+thread_local unsigned int ThreadPool::tls_index_ = 0;
+
+namespace {
+ThreadPoolOptions fixedSizeOptions(unsigned int num) {
   unsigned int hardware_threads = std::thread::hardware_concurrency();
 
   if (num == static_cast<unsigned int>(-1)) {
@@ -18,52 +80,803 @@ ThreadPool::ThreadPool(unsigned int num) {
     num = 1;
   }
 
-  threads_.reserve(num);
-  for (unsigned int i = 0; i < num; i++) {
-    threads_.emplace_back([this]() {
-      while (true) {
-        Task task;
-        {
-          std::unique_lock<std::mutex> lock(mtx_);
-          cv_.wait(lock, [this]() { return !task_list_.empty() || stop_; });
-          if (task_list_.empty() && stop_) break;
-          task = std::move(task_list_.front());
-          task_list_.pop();
-        }
+  ThreadPoolOptions options;
+  options.min_threads = num;
+  options.max_threads = num;
+  return options;
+}
 
-        try {
-          task();
-        } catch (std::exception& e) {
-          std::cerr << "ThreadPool task exception:" << e.what() << std::endl;
-        }
+ThreadPoolOptions normalize(ThreadPoolOptions options) {
+  // 至少常驻一个线程，否则没有线程能发现排队延迟并扩容
+  if (options.min_threads == 0) options.min_threads = 1;
+  if (options.max_threads < options.min_threads) {
+    options.max_threads = options.min_threads;
+  }
+  // 单核上自旋只会占住提交任务的线程本该使用的 CPU
+  if (std::thread::hardware_concurrency() == 1) options.spin_count = 0;
+  if (options.placement == WorkerPlacement::kExplicit &&
+      options.cpus.empty()) {
+    throw std::invalid_argument("Explicit placement needs a CPU list!");
+  }
+  return options;
+}
+
+// 自旋等待时提示 CPU 降低功耗、让出流水线给同核的超线程
+inline void cpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#elif defined(__aarch64__)
+  asm volatile("yield");
+#else
+  std::this_thread::yield();
+#endif
+}
+
+// 单写者计数器的累加，不需要带 lock 前缀的原子指令
+inline void bump(std::atomic<std::uint64_t>& counter, std::uint64_t value) {
+  counter.store(counter.load(std::memory_order_relaxed) + value,
+                std::memory_order_relaxed);
+}
+
+// 无锁环模式下登记一次正在进行的提交
+class PostingGuard {
+ public:
+  explicit PostingGuard(std::atomic<unsigned int>& posting)
+      : posting_(posting) {
+    posting_.fetch_add(1);
+  }
+  ~PostingGuard() { posting_.fetch_sub(1); }
+
+ private:
+  std::atomic<unsigned int>& posting_;
+};
+
+// 定时任务的时间粒度
+using TimerTick = std::chrono::milliseconds;
+
+inline std::uint64_t toNanos(std::chrono::steady_clock::duration d) {
+  const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(d);
+  return ns.count() > 0 ? static_cast<std::uint64_t>(ns.count()) : 0;
+}
+}  // namespace
+
+ThreadPool::ThreadPool(unsigned int num)
+    : ThreadPool(fixedSizeOptions(num)) {}
+
+ThreadPool::ThreadPool(const ThreadPoolOptions& options)
+    : options_(normalize(options)),
+      elastic_(options_.min_threads < options_.max_threads),
+      ring_(options_.backend == QueueBackend::kLockFreeRing),
+      stats_(new WorkerStats[options_.max_threads]),
+      state_slab_(TaskStateSlab::create()),
+      timer_epoch_(Clock::now()) {
+  // 先建好全部槽位的队列再启动线程，工作线程窃取时会遍历整个 queues_
+  queues_.reserve(options_.max_threads);
+  for (unsigned int i = 0; i < options_.max_threads; i++) {
+    queues_.push_back(std::make_unique<WorkerQueue>());
+    if (ring_) {
+      for (auto& ring : queues_.back()->rings) {
+        ring = std::make_unique<MpmcRing<QueuedJob>>(options_.queue_capacity);
       }
-    });
+    }
+  }
+  threads_.resize(options_.max_threads);
+  assignPlacement();
+
+  std::lock_guard<std::mutex> lock(mtx_);
+  for (unsigned int i = 0; i < options_.min_threads; i++) {
+    startWorker(i);
   }
 }
 
 ThreadPool::~ThreadPool() noexcept {
   stop();
+  if (timer_thread_.joinable()) timer_thread_.join();
+  // stop() 之后不会再有线程被创建，threads_ 不再变化
   for (int i = 0; i < threads_.size(); i++) {
-    threads_[i].join();
+    if (threads_[i].joinable()) {
+      threads_[i].join();
+    }
+  }
+  // 未到期的定时任务随时间轮一起丢弃
+  wheel_.clear([](TimerWheel::Node* node) {
+    static_cast<Timer*>(node)->self.reset();
+  });
+  // 仍在外部存活的 future 会在自身释放时归还内存块，最后一个归还者负责销毁回收池
+  state_slab_->release();
+}
+
+void ThreadPool::assignPlacement() {
+  const unsigned int count = options_.max_threads;
+  if (options_.placement != WorkerPlacement::kNone) {
+    const CpuTopology topology = CpuTopology::detect();
+    // 第 i 个槽位绑定 order[i % order.size()]
+    std::vector<unsigned int> order;
+    switch (options_.placement) {
+      case WorkerPlacement::kCompact:
+        for (const auto& cpus : topology.nodes) {
+          order.insert(order.end(), cpus.begin(), cpus.end());
+        }
+        break;
+      case WorkerPlacement::kScatter:
+        for (size_t round = 0; order.size() < topology.cpuCount(); round++) {
+          for (const auto& cpus : topology.nodes) {
+            if (round < cpus.size()) order.push_back(cpus[round]);
+          }
+        }
+        break;
+      case WorkerPlacement::kExplicit:
+      default:
+        order = options_.cpus;
+        break;
+    }
+    for (unsigned int i = 0; i < count; i++) {
+      WorkerQueue& queue = *queues_[i];
+      const unsigned int cpu = order[i % order.size()];
+      queue.cpu = static_cast<int>(cpu);
+      queue.node = topology.nodeOf(cpu);
+    }
+
+    // 单节点时同节点优先没有意义，外部提交保持全局轮询
+    if (topology.nodes.size() > 1) {
+      node_queues_.resize(topology.nodes.size());
+      for (unsigned int i = 0; i < count; i++) {
+        node_queues_[queues_[i]->node].push_back(i);
+      }
+      for (size_t node = 0; node < topology.nodes.size(); node++) {
+        for (unsigned int cpu : topology.nodes[node]) {
+          if (cpu >= cpu_node_.size()) cpu_node_.resize(cpu + 1, 0);
+          cpu_node_[cpu] = static_cast<unsigned int>(node);
+        }
+      }
+    }
+  }
+
+  // 不绑核时所有槽位都在节点 0，顺序退化为从本队列开始的环形遍历
+  for (unsigned int i = 0; i < count; i++) {
+    WorkerQueue& queue = *queues_[i];
+    std::vector<unsigned int> remote;
+    queue.victims.push_back(i);
+    for (unsigned int k = 1; k < count; k++) {
+      const unsigned int peer = (i + k) % count;
+      if (queues_[peer]->node == queue.node) {
+        queue.victims.push_back(peer);
+      } else {
+        remote.push_back(peer);
+      }
+    }
+    queue.victims.insert(queue.victims.end(), remote.begin(), remote.end());
   }
 }
 
+ThreadPoolStats ThreadPool::snapshot() const {
+  ThreadPoolStats stats;
+  stats.threads = threadCount();
+  for (unsigned int lane = 0; lane < kPriorityCount; lane++) {
+    stats.queue_depth[lane] = queueDepth(static_cast<TaskPriority>(lane));
+  }
+  stats.workers.resize(queues_.size());
+  for (size_t i = 0; i < queues_.size(); i++) {
+    const WorkerStats& source = stats_[i];
+    ThreadPoolStats::Worker& worker = stats.workers[i];
+    worker.active = queues_[i]->active.load(std::memory_order_relaxed);
+    worker.tasks = source.tasks.load(std::memory_order_relaxed);
+    worker.steals = source.steals.load(std::memory_order_relaxed);
+    worker.busy = std::chrono::nanoseconds(
+        source.busy_ns.load(std::memory_order_relaxed));
+    worker.idle = std::chrono::nanoseconds(
+        source.idle_ns.load(std::memory_order_relaxed));
+    for (unsigned int b = 0; b < LatencyHistogram::kBuckets; b++) {
+      stats.queue_wait.counts[b] +=
+          source.queue_wait[b].load(std::memory_order_relaxed);
+      stats.run_time.counts[b] +=
+          source.run_time[b].load(std::memory_order_relaxed);
+    }
+  }
+  return stats;
+}
+
 void ThreadPool::stop() {
+  stop_ = true;
   {
     std::lock_guard<std::mutex> lock(mtx_);
-    stop_ = true;
   }
   cv_.notify_all();
+  {
+    std::lock_guard<std::mutex> lock(timer_mtx_);
+  }
+  timer_cv_.notify_all();
 }
 
 void ThreadPool::abort() {
+  stop_ = true;
+  for (auto& queue : queues_) {
+    if (ring_) {
+      QueuedJob item;
+      for (unsigned int lane = 0; lane < kPriorityCount; lane++) {
+        while (queue->rings[lane]->try_pop(item)) {
+          lanes_[lane].depth.fetch_sub(1);
+          item.job.reset();
+        }
+      }
+    }
+    RingDeque<QueuedJob> dropped[kPriorityCount];
+    {
+      std::lock_guard<std::mutex> lock(queue->mtx);
+      for (unsigned int lane = 0; lane < kPriorityCount; lane++) {
+        dropped[lane].swap(queue->lanes[lane]);
+        const auto size = static_cast<std::ptrdiff_t>(dropped[lane].size());
+        if (ring_) unbounded_.fetch_sub(size);
+        lanes_[lane].depth.fetch_sub(size);
+      }
+    }
+  }
   {
     std::lock_guard<std::mutex> lock(mtx_);
-    std::queue<Task> empty_que;
-    empty_que.swap(task_list_);
-    stop_ = true;
   }
   cv_.notify_all();
+  {
+    std::lock_guard<std::mutex> lock(timer_mtx_);
+  }
+  timer_cv_.notify_all();
+}
+
+bool ThreadPool::drainFor(Clock::duration timeout) {
+  const Clock::time_point deadline = Clock::now() + timeout;
+  stop();
+  bool drained;
+  {
+    std::unique_lock<std::mutex> lock(mtx_);
+    drained = exit_cv_.wait_until(lock, deadline, [this] {
+      return active_threads_.load(std::memory_order_relaxed) == 0;
+    });
+  }
+  // 正在执行的任务不受影响，丢弃的任务的 future 得到 broken_promise
+  if (!drained) abort();
+  return drained;
+}
+
+unsigned int ThreadPool::pickQueue() {
+  if (tls_pool_ == this) {
+    return tls_index_;
+  }
+  // 绑核且有多个节点时，优先在提交线程所在节点的队列间轮询
+  if (!node_queues_.empty()) {
+    const int cpu = currentCpu();
+    if (cpu >= 0 && static_cast<size_t>(cpu) < cpu_node_.size()) {
+      const auto& slots = node_queues_[cpu_node_[cpu]];
+      for (size_t i = 0; i < slots.size(); i++) {
+        const unsigned int index =
+            slots[next_queue_.fetch_add(1, std::memory_order_relaxed) %
+                  slots.size()];
+        if (queues_[index]->active.load(std::memory_order_relaxed)) {
+          return index;
+        }
+      }
+    }
+  }
+  // 轮询分发，跳过没有工作线程的槽位；即使槽位恰好刚退出，任务也会被其他线程窃取
+  const size_t count = queues_.size();
+  unsigned int index = 0;
+  for (size_t i = 0; i < count; i++) {
+    index = next_queue_.fetch_add(1, std::memory_order_relaxed) % count;
+    if (queues_[index]->active.load(std::memory_order_relaxed)) break;
+  }
+  return index;
+}
+
+void ThreadPool::post(Job task, TaskPriority priority) {
+  const auto lane = static_cast<unsigned int>(priority);
+  const unsigned int index = pickQueue();
+  const Clock::time_point now = Clock::now();
+  if (ring_) {
+    PostingGuard guard(posting_);
+    if (stop_) throw std::logic_error("Thread pool has stopped!");
+    if (enqueueRing(std::move(task), lane, index, now)) wakeOne();
+    return;
+  }
+  bool backlogged = false;
+  {
+    // stop_ 在队列锁内检查：工作线程退出前会逐个加锁确认队列为空，
+    // 因此检查通过的任务一定会被执行
+    WorkerQueue& queue = *queues_[index];
+    std::lock_guard<std::mutex> lock(queue.mtx);
+    if (stop_) throw std::logic_error("Thread pool has stopped!");
+    auto& tasks = queue.lanes[lane];
+    backlogged = elastic_ && !tasks.empty() &&
+                 now - tasks.front().enqueued > options_.grow_latency;
+    tasks.push_back(QueuedJob{std::move(task), now});
+    lanes_[lane].depth.fetch_add(1);
+  }
+  wakeOne();
+  if (backlogged) maybeGrow(now);
+}
+
+void ThreadPool::postUnbounded(Job task, TaskPriority priority) {
+  if (!ring_) {
+    post(std::move(task), priority);
+    return;
+  }
+  // 绕过无锁环和 OverflowPolicy，放进不限长度的互斥队列
+  const auto lane = static_cast<unsigned int>(priority);
+  PostingGuard guard(posting_);
+  if (stop_) throw std::logic_error("Thread pool has stopped!");
+  {
+    WorkerQueue& queue = *queues_[pickQueue()];
+    std::lock_guard<std::mutex> lock(queue.mtx);
+    queue.lanes[lane].push_back(QueuedJob{std::move(task), Clock::now()});
+    unbounded_.fetch_add(1);
+    lanes_[lane].depth.fetch_add(1);
+  }
+  wakeOne();
+}
+
+void ThreadPool::postBatch(std::vector<Job>& tasks, TaskPriority priority) {
+  if (tasks.empty()) return;
+
+  const auto lane = static_cast<unsigned int>(priority);
+  const size_t total = tasks.size();
+  const Clock::time_point now = Clock::now();
+  if (ring_) {
+    // 无锁环逐个入队，只唤醒实际入队的任务数。
+    // kReject 时抛出异常前已入队的任务仍会执行
+    PostingGuard guard(posting_);
+    if (stop_) throw std::logic_error("Thread pool has stopped!");
+    size_t queued = 0;
+    for (auto& task : tasks) {
+      if (enqueueRing(std::move(task), lane, pickQueue(), now)) queued++;
+    }
+    wakeWorkers(queued);
+    return;
+  }
+  if (tls_pool_ == this) {
+    // 工作线程内的批量提交整批压入本地队列，空闲线程会来窃取
+    WorkerQueue& queue = *queues_[tls_index_];
+    std::lock_guard<std::mutex> lock(queue.mtx);
+    if (stop_) throw std::logic_error("Thread pool has stopped!");
+    for (auto& task : tasks) {
+      queue.lanes[lane].push_back(QueuedJob{std::move(task), now});
+    }
+    lanes_[lane].depth.fetch_add(total);
+  } else {
+    // 外部提交：把整批切成连续的几段，分给从轮询位置开始的若干个队列。
+    // 按下标升序一次锁住全部目标队列，保证整批要么全部入队，要么因停止而全部拒绝
+    const size_t count = queues_.size();
+    const size_t parts = total < count ? total : count;
+    const size_t start =
+        next_queue_.fetch_add(static_cast<unsigned int>(parts),
+                              std::memory_order_relaxed) %
+        count;
+
+    std::vector<std::unique_lock<std::mutex>> locks;
+    locks.reserve(parts);
+    for (size_t index = 0; index < count; index++) {
+      if ((index + count - start) % count < parts) {
+        locks.emplace_back(queues_[index]->mtx);
+      }
+    }
+    if (stop_) throw std::logic_error("Thread pool has stopped!");
+
+    for (size_t part = 0; part < parts; part++) {
+      WorkerQueue& queue = *queues_[(start + part) % count];
+      const size_t first = part * total / parts;
+      const size_t last = (part + 1) * total / parts;
+      for (size_t i = first; i < last; i++) {
+        queue.lanes[lane].push_back(QueuedJob{std::move(tasks[i]), now});
+      }
+    }
+    lanes_[lane].depth.fetch_add(total);
+  }
+  wakeWorkers(total);
+}
+
+bool ThreadPool::enqueueRing(Job task, unsigned int lane, unsigned int index,
+                             Clock::time_point now) {
+  QueuedJob item{std::move(task), now};
+  if (pushToRing(index, lane, item)) return true;
+
+  OverflowPolicy policy = options_.overflow;
+  // 工作线程等待自己所在池的队列腾出空间可能导致所有线程互相等待
+  if (policy == OverflowPolicy::kBlock && tls_pool_ == this) {
+    policy = OverflowPolicy::kRunInline;
+  }
+  switch (policy) {
+    case OverflowPolicy::kReject:
+      throw std::overflow_error("Thread pool queue is full!");
+    case OverflowPolicy::kRunInline:
+      item.job();
+      return false;
+    case OverflowPolicy::kBlock:
+    default:
+      // 队列满说明积压严重，弹性模式下先尝试扩容
+      maybeGrow(Clock::now());
+      wakeOne();
+      while (!pushToRing(index, lane, item)) {
+        if (stop_) throw std::logic_error("Thread pool has stopped!");
+        std::this_thread::yield();
+      }
+      return true;
+  }
+}
+
+bool ThreadPool::pushToRing(unsigned int index, unsigned int lane,
+                            QueuedJob& item) {
+  // 先试选中的队列，满了再依次试其他有工作线程的队列
+  const size_t count = queues_.size();
+  for (size_t i = 0; i < count; i++) {
+    WorkerQueue& queue = *queues_[(index + i) % count];
+    if (i > 0 && !queue.active.load(std::memory_order_relaxed)) continue;
+    if (queue.rings[lane]->try_push(std::move(item))) {
+      lanes_[lane].depth.fetch_add(1);
+      return true;
+    }
+  }
+  return false;
+}
+
+void ThreadPool::wakeWorkers(size_t count) {
+  // 正在自旋的线程会自己发现新任务
+  const unsigned int spinning = spinning_.load();
+  if (count <= spinning) return;
+  count -= spinning;
+
+  const unsigned int idle = idle_.load();
+  if (idle == 0) return;
+  {
+    std::lock_guard<std::mutex> lock(mtx_);
+  }
+  // 只唤醒实际需要的线程数，任务比空闲线程多时才全部唤醒
+  if (count >= idle) {
+    cv_.notify_all();
+  } else {
+    for (size_t i = 0; i < count; i++) cv_.notify_one();
+  }
+}
+
+void ThreadPool::wakeOne() {
+  // 没有线程休眠、或已有线程在自旋时不碰 mtx_ / cv_，
+  // 避免繁忙时每个任务都付出一次唤醒开销。
+  // 自旋线程停止自旋后会在 mtx_ 内重新检查车道深度，不会漏掉任务；
+  // 它找到任务后还会再唤醒一个线程（见 workerLoop），一批任务不会只由它执行
+  if (idle_.load() == 0 || spinning_.load() > 0) return;
+  {
+    std::lock_guard<std::mutex> lock(mtx_);
+  }
+  cv_.notify_one();
+}
+
+void ThreadPool::startWorker(unsigned int index) {
+  // 调用方持有 mtx_
+  queues_[index]->active.store(true, std::memory_order_relaxed);
+  active_threads_.fetch_add(1, std::memory_order_relaxed);
+  threads_[index] = std::thread(&ThreadPool::workerLoop, this, index);
+}
+
+void ThreadPool::maybeGrow(Clock::time_point now) {
+  if (!elastic_) return;
+  if (active_threads_.load(std::memory_order_relaxed) >=
+          options_.max_threads ||
+      idle_.load() + spinning_.load() > 0) {
+    return;
+  }
+  // 两次扩容至少间隔 grow_latency，给新线程留出消化积压的时间
+  Clock::rep last = last_grow_.load(std::memory_order_relaxed);
+  const Clock::rep current = now.time_since_epoch().count();
+  if (current - last <
+          std::chrono::duration_cast<Clock::duration>(options_.grow_latency)
+              .count() ||
+      !last_grow_.compare_exchange_strong(last, current,
+                                          std::memory_order_relaxed)) {
+    return;
+  }
+
+  std::thread retired;
+  {
+    std::lock_guard<std::mutex> lock(mtx_);
+    if (stop_ || active_threads_ >= options_.max_threads) return;
+    unsigned int index = 0;
+    while (queues_[index]->active.load(std::memory_order_relaxed)) index++;
+    // 槽位上可能还留着已退出线程的对象，移出来在锁外 join
+    retired = std::move(threads_[index]);
+    startWorker(index);
+  }
+  if (retired.joinable()) retired.join();
+}
+
+bool ThreadPool::tryRetire(unsigned int index) {
+  // 调用方持有 mtx_，且刚刚空闲等待超时
+  if (stop_ || active_threads_ <= options_.min_threads) return false;
+  queues_[index]->active.store(false, std::memory_order_relaxed);
+  active_threads_.fetch_sub(1, std::memory_order_relaxed);
+  return true;
+}
+
+void ThreadPool::workerLoop(unsigned int index) {
+  tls_pool_ = this;
+  tls_index_ = index;
+  // 绑核失败（CPU 不存在或不在允许集合内）时退化为不绑核
+  if (queues_[index]->cpu >= 0) pinCurrentThread(queues_[index]->cpu);
+
+  WorkerStats& stats = stats_[index];
+  // 上一个任务结束（或线程启动）的时刻，到下一个任务开始之间计为空闲
+  Clock::time_point idle_since = Clock::now();
+  // 刚结束自旋或被唤醒，还没有取到任务
+  bool searching = false;
+  while (true) {
+    QueuedJob item;
+    if (popTask(index, item)) {
+      // 与 Go 调度器相同：找到任务的线程在执行前再唤醒一个线程。
+      // 提交方看到有线程自旋时不唤醒，一批任务靠这样逐个唤醒休眠的线程
+      if (searching) {
+        searching = false;
+        if (hasPending()) wakeOne();
+      }
+      const Clock::time_point start = Clock::now();
+      const std::uint64_t wait = toNanos(start - item.enqueued);
+      if (elastic_ && start - item.enqueued > options_.grow_latency) {
+        maybeGrow(start);
+      }
+      try {
+        item.job();
+      } catch (std::exception& e) {
+        std::cerr << "ThreadPool task exception:" << e.what() << std::endl;
+      } catch (...) {
+        std::cerr << "ThreadPool task exception: unknown" << std::endl;
+      }
+      const Clock::time_point end = Clock::now();
+      const std::uint64_t run = toNanos(end - start);
+      bump(stats.tasks, 1);
+      bump(stats.busy_ns, run);
+      bump(stats.idle_ns, toNanos(start - idle_since));
+      bump(stats.queue_wait[LatencyHistogram::bucketOf(wait)], 1);
+      bump(stats.run_time[LatencyHistogram::bucketOf(run)], 1);
+      idle_since = end;
+      continue;
+    }
+
+    if (stop_ && allQueuesEmpty()) {
+      std::lock_guard<std::mutex> lock(mtx_);
+      bump(stats.idle_ns, toNanos(Clock::now() - idle_since));
+      queues_[index]->active.store(false, std::memory_order_relaxed);
+      active_threads_.fetch_sub(1, std::memory_order_relaxed);
+      exit_cv_.notify_all();
+      break;
+    }
+    if (spinForTask()) {
+      searching = true;
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock(mtx_);
+    idle_.fetch_add(1);
+    auto ready = [this]() { return hasPending() || stop_; };
+    bool woken = true;
+    if (elastic_) {
+      woken = cv_.wait_for(lock, options_.idle_timeout, ready);
+    } else {
+      cv_.wait(lock, ready);
+    }
+    idle_.fetch_sub(1);
+    if (!woken) {
+      // 统计只能由槽位上的线程写入：退出前在锁内记下最后一段空闲，
+      // 清除 active 之后 maybeGrow 可能马上在这个槽位启动新线程
+      const Clock::time_point now = Clock::now();
+      bump(stats.idle_ns, toNanos(now - idle_since));
+      idle_since = now;
+      if (tryRetire(index)) break;
+    }
+    searching = true;
+  }
+
+  tls_pool_ = nullptr;
+}
+
+bool ThreadPool::TimerHandle::cancel() {
+  const std::shared_ptr<Timer> timer = timer_.lock();
+  return timer && timer->pool->cancelTimer(*timer);
+}
+
+std::uint64_t ThreadPool::currentTick() const {
+  return static_cast<std::uint64_t>(
+      std::chrono::floor<TimerTick>(Clock::now() - timer_epoch_).count());
+}
+
+ThreadPool::TimerHandle ThreadPool::addTimer(Job fn, Clock::duration delay,
+                                             Clock::duration interval,
+                                             TaskPriority priority) {
+  auto timer = std::make_shared<Timer>();
+  timer->fn = std::move(fn);
+  timer->interval = static_cast<std::uint64_t>(
+      std::chrono::ceil<TimerTick>(interval).count());
+  timer->priority = priority;
+  timer->pool = this;
+  if (delay < Clock::duration::zero()) delay = Clock::duration::zero();
+  // 向上取整：到期 tick 对应的时刻不早于 now + delay
+  const auto expiry = static_cast<std::uint64_t>(
+      std::chrono::ceil<TimerTick>(Clock::now() - timer_epoch_ + delay)
+          .count());
+
+  bool notify = false;
+  {
+    std::lock_guard<std::mutex> lock(timer_mtx_);
+    if (stop_) throw std::logic_error("Thread pool has stopped!");
+    if (!timer_thread_.joinable()) {
+      timer_thread_ = std::thread(&ThreadPool::timerLoop, this);
+    }
+    timer->self = timer;
+    wheel_.insert(timer.get(), expiry);
+    notify = timer->expiry < wake_tick_;
+  }
+  if (notify) timer_cv_.notify_one();
+  return TimerHandle(timer);
+}
+
+bool ThreadPool::cancelTimer(Timer& timer) {
+  std::shared_ptr<Timer> self;
+  std::lock_guard<std::mutex> lock(timer_mtx_);
+  if (timer.cancelled.exchange(true)) return false;
+  wheel_.remove(&timer);
+  // 在锁外释放，fn 的析构不占用 timer_mtx_
+  self = std::move(timer.self);
+  return true;
+}
+
+void ThreadPool::fireTimer(std::shared_ptr<Timer> timer) {
+  if (timer->interval != 0 && timer->running.exchange(true)) return;
+  Timer& ref = *timer;
+  try {
+    // 队列满时就地执行或阻塞都会让定时线程耽误其他定时任务，因此不受容量限制
+    postUnbounded(Job([timer = std::move(timer)] {
+           if (timer->interval == 0) {
+             // 与 cancel() 竞争：先置位的一方生效
+             if (!timer->cancelled.exchange(true)) timer->fn();
+             return;
+           }
+           if (!timer->cancelled.load()) {
+             try {
+               timer->fn();
+             } catch (...) {
+               timer->running = false;
+               throw;
+             }
+           }
+           timer->running = false;
+         }),
+         ref.priority);
+  } catch (const std::exception&) {
+    // 线程池已停止：丢弃本次触发
+    ref.running = false;
+  }
+}
+
+void ThreadPool::timerLoop() {
+  std::vector<std::shared_ptr<Timer>> due;
+  std::unique_lock<std::mutex> lock(timer_mtx_);
+  while (!stop_) {
+    const std::uint64_t tick = currentTick();
+    wheel_.advanceTo(tick, [this, tick, &due](TimerWheel::Node* node) {
+      auto* timer = static_cast<Timer*>(node);
+      if (timer->interval == 0) {
+        due.push_back(std::move(timer->self));
+        return;
+      }
+      due.push_back(timer->self);
+      // 固定频率重新挂上时间轮；落后超过一个周期时跳过错过的几次
+      std::uint64_t next = timer->expiry + timer->interval;
+      if (next <= tick) {
+        next += ((tick - next) / timer->interval + 1) * timer->interval;
+      }
+      wheel_.insert(timer, next);
+    });
+    if (!due.empty()) {
+      // 投递时不持有 timer_mtx_，期间可以继续添加和取消定时任务
+      lock.unlock();
+      for (auto& timer : due) fireTimer(std::move(timer));
+      due.clear();
+      lock.lock();
+      continue;
+    }
+
+    wake_tick_ = wheel_.nextTick();
+    if (wake_tick_ == TimerWheel::kNever) {
+      timer_cv_.wait(lock);
+    } else {
+      timer_cv_.wait_until(lock, timer_epoch_ + TimerTick(wake_tick_));
+    }
+    wake_tick_ = 0;
+  }
+}
+
+bool ThreadPool::spinForTask() {
+  if (options_.spin_count == 0) return false;
+  spinning_.fetch_add(1);
+  bool found = false;
+  for (unsigned int i = 0; i < options_.spin_count; i++) {
+    if (hasPending() || stop_) {
+      found = true;
+      break;
+    }
+    cpuRelax();
+  }
+  spinning_.fetch_sub(1);
+  return found;
+}
+
+bool ThreadPool::hasPending() const {
+  for (const auto& lane : lanes_) {
+    if (lane.depth.load() > 0) return true;
+  }
+  return false;
+}
+
+bool ThreadPool::allQueuesEmpty() {
+  if (posting_.load() != 0) return false;
+  for (auto& queue : queues_) {
+    if (ring_) {
+      for (const auto& ring : queue->rings) {
+        if (!ring->empty()) return false;
+      }
+      if (unbounded_.load() == 0) continue;
+    }
+    std::lock_guard<std::mutex> lock(queue->mtx);
+    for (const auto& lane : queue->lanes) {
+      if (!lane.empty()) return false;
+    }
+  }
+  return true;
+}
+
+bool ThreadPool::popTask(unsigned int index, QueuedJob& item) {
+  unsigned int lowest = kPriorityCount;
+  for (unsigned int lane = kPriorityCount; lane-- > 0;) {
+    if (lanes_[lane].depth.load(std::memory_order_relaxed) > 0) {
+      lowest = lane;
+      break;
+    }
+  }
+  if (lowest == kPriorityCount) return false;
+
+  // 防饿死：高优先级任务连续执行够多后，让最低的非空车道先执行一个
+  WorkerQueue& local = *queues_[index];
+  if (local.streak >= kStarvationLimit && popFromLane(index, lowest, item)) {
+    local.streak = 0;
+    return true;
+  }
+
+  for (unsigned int lane = 0; lane < kPriorityCount; lane++) {
+    if (lanes_[lane].depth.load(std::memory_order_relaxed) <= 0) continue;
+    if (popFromLane(index, lane, item)) {
+      local.streak = lane < lowest ? local.streak + 1 : 0;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool ThreadPool::popFromLane(unsigned int index, unsigned int lane,
+                             QueuedJob& item) {
+  // 先取本地队列，再按 FIFO 从其他线程的同一车道窃取，同节点的队列优先
+  for (unsigned int victim : queues_[index]->victims) {
+    WorkerQueue& queue = *queues_[victim];
+    if (ring_) {
+      if (queue.rings[lane]->try_pop(item)) {
+        lanes_[lane].depth.fetch_sub(1);
+        if (victim != index) bump(stats_[index].steals, 1);
+        return true;
+      }
+      if (unbounded_.load() == 0) continue;
+    }
+    std::lock_guard<std::mutex> lock(queue.mtx);
+    if (!queue.lanes[lane].empty()) {
+      item = std::move(queue.lanes[lane].front());
+      queue.lanes[lane].pop_front();
+      if (ring_) unbounded_.fetch_sub(1);
+      lanes_[lane].depth.fetch_sub(1);
+      if (victim != index) bump(stats_[index].steals, 1);
+      return true;
+    }
+  }
+  return false;
 }
 
 // =============================test=============================
@@ -0,0 +1,474 @@
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "playground/threading/async_log.h"
+
+using namespace playground;
+
+namespace {
+// 统计以 strBase 开头的日志文件中包含 strText 的行数，不删除文件
+int countLines(const std::string& strBase, const std::string& strText) {
+  namespace fs = std::filesystem;
+  const fs::path base(strBase);
+  int count = 0;
+  for (const auto& entry : fs::directory_iterator(base.parent_path())) {
+    const std::string name = entry.path().filename().string();
+    if (name.rfind(base.filename().string(), 0) != 0) continue;
+    std::ifstream in(entry.path());
+    for (std::string line; std::getline(in, line);) {
+      if (line.find(strText) != std::string::npos) count++;
+    }
+  }
+  return count;
+}
+
+// 收集以 strBase 开头的日志文件中的全部行，读完后删除这些文件
+std::vector<std::string> readAndRemoveLogs(const std::string& strBase) {
+  namespace fs = std::filesystem;
+  const fs::path base(strBase);
+  std::vector<std::string> lines;
+  for (const auto& entry : fs::directory_iterator(base.parent_path())) {
+    const std::string name = entry.path().filename().string();
+    if (name.rfind(base.filename().string(), 0) != 0) continue;
+    std::ifstream in(entry.path());
+    for (std::string line; std::getline(in, line);) lines.push_back(line);
+    in.close();
+    fs::remove(entry.path());
+  }
+  return lines;
+}
+
+// 把标准输出换成管道，只输出到控制台。管道写满后写线程阻塞在输出上，
+// 模拟磁盘卡顿。produce 在新线程中运行，使用当前设置的缓冲区容量；
+// bReadWhileLogging 为 false 时等 produce 返回后才开始读管道
+std::string logWithStalledWriter(bool bReadWhileLogging,
+                                 const std::function<void()>& produce) {
+  fflush(stdout);
+  const int nSavedStdout = ::dup(STDOUT_FILENO);
+  int fds[2];
+  if (::pipe(fds) != 0) return std::string();
+  ::dup2(fds[1], STDOUT_FILENO);
+  ::close(fds[1]);
+
+  std::string strOutput;
+  std::thread reader;
+  auto startReader = [&]() {
+    reader = std::thread([&]() {
+      char szBuf[4096];
+      ssize_t n;
+      while ((n = ::read(fds[0], szBuf, sizeof(szBuf))) > 0) {
+        strOutput.append(szBuf, n);
+      }
+    });
+  };
+
+  CAsyncLog::init();
+  if (bReadWhileLogging) startReader();
+  std::thread(produce).join();
+  if (!bReadWhileLogging) startReader();
+  CAsyncLog::uninit();
+
+  // 恢复标准输出后管道的写端全部关闭，读线程读到文件尾
+  fflush(stdout);
+  ::dup2(nSavedStdout, STDOUT_FILENO);
+  ::close(nSavedStdout);
+  reader.join();
+  ::close(fds[0]);
+  return strOutput;
+}
+
+int countText(const std::string& strOutput, const std::string& strText) {
+  int count = 0;
+  for (size_t i = strOutput.find(strText); i != std::string::npos;
+       i = strOutput.find(strText, i + 1)) {
+    count++;
+  }
+  return count;
+}
+
+// 汇总行中丢弃行数的合计
+uint64_t summarizedDrops(const std::string& strOutput) {
+  const std::string strKey = "log queue full, dropped ";
+  uint64_t nTotal = 0;
+  for (size_t i = strOutput.find(strKey); i != std::string::npos;
+       i = strOutput.find(strKey, i + 1)) {
+    nTotal += std::stoull(strOutput.substr(i + strKey.size()));
+  }
+  return nTotal;
+}
+
+const std::string kPadding(64, 'x');
+}  // namespace
+
+// 编译期过滤不影响 FATAL 和 CRITICAL
+#pragma push_macro("PLAYGROUND_LOG_MIN_LEVEL")
+#undef PLAYGROUND_LOG_MIN_LEVEL
+#define PLAYGROUND_LOG_MIN_LEVEL (LOG_LEVEL_CRITICAL + 1)
+static_assert(!PLAYGROUND_LOG_ENABLED(LOG_LEVEL_ERROR));
+static_assert(PLAYGROUND_LOG_ENABLED(LOG_LEVEL_FATAL));
+static_assert(PLAYGROUND_LOG_ENABLED(LOG_LEVEL_CRITICAL));
+#pragma pop_macro("PLAYGROUND_LOG_MIN_LEVEL")
+
+TEST(AsyncLogTest, PreservesPerThreadOrder) {
+  const std::string strBase =
+      "/tmp/playground_async_log_" + std::to_string(::getpid());
+  ASSERT_TRUE(CAsyncLog::init(strBase.c_str()));
+  CAsyncLog::setLevel(LOG_LEVEL_INFO);
+
+  // 单个线程的日志量超过缓冲区容量，覆盖缓冲区写满的路径
+  constexpr int kThreads = 4;
+  constexpr int kLinesPerThread = 5000;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreads; t++) {
+    threads.emplace_back([t]() {
+      for (int i = 0; i < kLinesPerThread; i++) {
+        LOGI("worker=%d seq=%d", t, i);
+      }
+    });
+  }
+  for (auto& thread : threads) thread.join();
+  // 退出的线程留下的日志也要写完
+  CAsyncLog::uninit();
+
+  std::vector<int> next(kThreads, 0);
+  int total = 0;
+  for (const std::string& line : readAndRemoveLogs(strBase)) {
+    const size_t pos = line.find("worker=");
+    if (pos == std::string::npos) continue;
+    int t = -1;
+    int i = -1;
+    ASSERT_EQ(std::sscanf(line.c_str() + pos, "worker=%d seq=%d", &t, &i), 2);
+    ASSERT_GE(t, 0);
+    ASSERT_LT(t, kThreads);
+    EXPECT_EQ(i, next[t]);
+    next[t] = i + 1;
+    total++;
+  }
+  EXPECT_EQ(total, kThreads * kLinesPerThread);
+}
+
+TEST(AsyncLogTest, RestartAfterUninit) {
+  // 同一秒内新建的日志文件同名，每一轮使用不同的文件名
+  const std::string strBase =
+      "/tmp/playground_async_log_restart_" + std::to_string(::getpid());
+  for (int round = 0; round < 2; round++) {
+    const std::string strName = strBase + "_" + std::to_string(round);
+    ASSERT_TRUE(CAsyncLog::init(strName.c_str()));
+    LOGI("round=%d", round);
+    CAsyncLog::uninit();
+  }
+  int total = 0;
+  for (const std::string& line : readAndRemoveLogs(strBase)) {
+    if (line.find("round=") != std::string::npos) total++;
+  }
+  EXPECT_EQ(total, 2);
+}
+
+TEST(AsyncLogTest, UninitRightAfterLoggingKeepsLines) {
+  // 提交日志后立即 uninit：写线程可能刚好发现缓冲区为空，随后看到退出标志
+  int lost = 0;
+  for (int round = 0; round < 200; round++) {
+    const std::string strOutput = logWithStalledWriter(
+        true, [round]() { LOGI("uninit round=%d end", round); });
+    const std::string strText = "]uninit round=" + std::to_string(round);
+    if (countText(strOutput, strText + " end") != 1) lost++;
+  }
+  EXPECT_EQ(lost, 0);
+}
+
+TEST(AsyncLogTest, IntervalFlushWhileIdle) {
+  const std::string strBase =
+      "/tmp/playground_async_log_interval_" + std::to_string(::getpid());
+  CAsyncLog::setConsoleEcho(false);
+  CAsyncLog::setFlushPolicy(LOG_FLUSH_INTERVAL, 20);
+  ASSERT_TRUE(CAsyncLog::init(strBase.c_str()));
+  LOGI("interval flush");
+
+  // 没有新日志时写线程也要按时刷新
+  int count = 0;
+  for (int i = 0; i < 200 && count == 0; i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    count = countLines(strBase, "interval flush");
+  }
+  EXPECT_EQ(count, 1);
+
+  CAsyncLog::uninit();
+  CAsyncLog::setFlushPolicy(LOG_FLUSH_EVERY_LINE);
+  CAsyncLog::setConsoleEcho(true);
+  readAndRemoveLogs(strBase);
+}
+
+TEST(AsyncLogTest, ByteFlushKeepsSmallBatchesBuffered) {
+  const std::string strBase =
+      "/tmp/playground_async_log_bytes_" + std::to_string(::getpid());
+  CAsyncLog::setConsoleEcho(false);
+  CAsyncLog::setFlushPolicy(LOG_FLUSH_BYTES, 1024);
+  ASSERT_TRUE(CAsyncLog::init(strBase.c_str()));
+  LOGI("byte flush");
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  EXPECT_EQ(countLines(strBase, "byte flush"), 0);
+
+  // uninit 关闭文件时写出剩余数据
+  CAsyncLog::uninit();
+  CAsyncLog::setFlushPolicy(LOG_FLUSH_EVERY_LINE);
+  CAsyncLog::setConsoleEcho(true);
+  EXPECT_EQ(countLines(strBase, "byte flush"), 1);
+  readAndRemoveLogs(strBase);
+}
+
+TEST(AsyncLogTest, DeferredLinesFormattedByWriter) {
+  const std::string strBase =
+      "/tmp/playground_async_log_deferred_" + std::to_string(::getpid());
+  CAsyncLog::setConsoleEcho(false);
+  ASSERT_TRUE(CAsyncLog::init(strBase.c_str()));
+  const char* pszName = "alice";
+  for (int i = 0; i < 3; i++) {
+    DLOGI("user=%s seq=%d ratio=%.2f", pszName, i, i / 4.0);
+  }
+  DLOGT("filtered %d", 1);
+  LOGI("text line");
+  CAsyncLog::uninit();
+  CAsyncLog::setConsoleEcho(true);
+
+  const std::vector<std::string> lines = readAndRemoveLogs(strBase);
+  ASSERT_EQ(lines.size(), 4u);
+  EXPECT_EQ(lines[0].rfind("[INFO][", 0), 0u);
+  EXPECT_NE(lines[0].find("]user=alice seq=0 ratio=0.00"), std::string::npos);
+  EXPECT_NE(lines[2].find("]user=alice seq=2 ratio=0.50"), std::string::npos);
+  EXPECT_NE(lines[3].find("text line"), std::string::npos);
+}
+
+TEST(AsyncLogTest, PrintfLinesLongerThanLineBuffer) {
+  const std::string strBase =
+      "/tmp/playground_async_log_printf_" + std::to_string(::getpid());
+  CAsyncLog::setConsoleEcho(false);
+  ASSERT_TRUE(CAsyncLog::init(strBase.c_str()));
+  // 长行超出行缓冲区时重新格式化，之后的短行复用扩大后的缓冲区
+  const std::string strLong(5000, 'y');
+  LOGI("short seq=%d", 0);
+  LOGI("long %s end", strLong.c_str());
+  LOGI("short seq=%d", 1);
+  LOGI("long %s end", strLong.c_str());
+  CAsyncLog::uninit();
+  CAsyncLog::setConsoleEcho(true);
+
+  const std::vector<std::string> lines = readAndRemoveLogs(strBase);
+  ASSERT_EQ(lines.size(), 4u);
+  const std::string strSuffix = "]long " + strLong + " end";
+  for (int i = 0; i < 4; i += 2) {
+    const std::string strShort = "]short seq=" + std::to_string(i / 2);
+    EXPECT_EQ(lines[i].substr(lines[i].size() - strShort.size()), strShort);
+    ASSERT_GT(lines[i + 1].size(), strSuffix.size());
+    EXPECT_EQ(lines[i + 1].substr(lines[i + 1].size() - strSuffix.size()),
+              strSuffix);
+  }
+}
+
+TEST(AsyncLogTest, BinaryFileDecodesToText) {
+  const std::string strBase =
+      "/tmp/playground_async_log_binary_" + std::to_string(::getpid());
+  CAsyncLog::setConsoleEcho(false);
+  CAsyncLog::setBinaryFile(true);
+  ASSERT_TRUE(CAsyncLog::init(strBase.c_str()));
+  DLOGW("request %u took %lld us", 7u, 1234ll);
+  LOGI("text line");
+  DLOGW("request %u took %lld us", 8u, 99ll);
+  CAsyncLog::uninit();
+  CAsyncLog::setBinaryFile(false);
+  CAsyncLog::setConsoleEcho(true);
+
+  namespace fs = std::filesystem;
+  std::string strText;
+  for (const auto& entry : fs::directory_iterator("/tmp")) {
+    const std::string name = entry.path().filename().string();
+    if (name.rfind(fs::path(strBase).filename().string(), 0) != 0) continue;
+    std::ifstream in(entry.path(), std::ios::binary);
+    const std::string strData((std::istreambuf_iterator<char>(in)),
+                              std::istreambuf_iterator<char>());
+    in.close();
+    fs::remove(entry.path());
+
+    LogDecoder decoder;
+    EXPECT_EQ(decoder.decode(strData.data(), strData.size(), strText),
+              strData.size());
+  }
+
+  const size_t nFirst = strText.find("]request 7 took 1234 us\n");
+  const size_t nText = strText.find("text line\n");
+  const size_t nSecond = strText.find("]request 8 took 99 us\n");
+  ASSERT_NE(nFirst, std::string::npos);
+  ASSERT_NE(nText, std::string::npos);
+  ASSERT_NE(nSecond, std::string::npos);
+  EXPECT_LT(nFirst, nText);
+  EXPECT_LT(nText, nSecond);
+  EXPECT_EQ(strText.rfind("[WARN][", 0), 0u);
+}
+
+TEST(AsyncLogTest, MappedFileHoldsOnlyWrittenLines) {
+  const std::string strBase =
+      "/tmp/playground_async_log_mapped_" + std::to_string(::getpid());
+  CAsyncLog::setConsoleEcho(false);
+  CAsyncLog::setMappedFile(true);
+  ASSERT_TRUE(CAsyncLog::init(strBase.c_str()));
+  for (int i = 0; i < 1000; i++) LOGI("mapped seq=%d", i);
+  DLOGI("deferred seq=%d", 1000);
+  CAsyncLog::uninit();
+  CAsyncLog::setMappedFile(false);
+  CAsyncLog::setConsoleEcho(true);
+
+  // 关闭时截断了预分配的部分，文件中没有多余的 0
+  const std::vector<std::string> lines = readAndRemoveLogs(strBase);
+  ASSERT_EQ(lines.size(), 1001u);
+  for (int i = 0; i < 1000; i++) {
+    EXPECT_NE(lines[i].find("]mapped seq=" + std::to_string(i)),
+              std::string::npos);
+  }
+  EXPECT_NE(lines[1000].find("]deferred seq=1000"), std::string::npos);
+  for (const std::string& line : lines) {
+    EXPECT_EQ(line.find('\0'), std::string::npos);
+  }
+}
+
+TEST(AsyncLogTest, MappedFileRollsToPreparedFile) {
+  namespace fs = std::filesystem;
+  const std::string strBase =
+      "/tmp/playground_async_log_mapped_roll_" + std::to_string(::getpid());
+  CAsyncLog::setConsoleEcho(false);
+  CAsyncLog::setMappedFile(true);
+  ASSERT_TRUE(CAsyncLog::init(strBase.c_str(), false, 4096));
+  for (int i = 0; i < 200; i++) {
+    LOGI("rolling seq=%d padding=%s", i, std::string(64, 'x').c_str());
+  }
+  CAsyncLog::uninit();
+  CAsyncLog::setMappedFile(false);
+  CAsyncLog::setConsoleEcho(true);
+
+  // 同一秒内轮转的文件同名，后面的会覆盖前面的，只检查剩下的文件
+  int nFiles = 0;
+  for (const auto& entry : fs::directory_iterator("/tmp")) {
+    const std::string name = entry.path().filename().string();
+    if (name.rfind(fs::path(strBase).filename().string(), 0) != 0) continue;
+    nFiles++;
+    // 提前建好的文件在 uninit 时删除
+    EXPECT_EQ(entry.path().extension(), ".log");
+    EXPECT_LT(fs::file_size(entry.path()), 4096u + 1024u);
+  }
+  EXPECT_GE(nFiles, 1);
+
+  const std::vector<std::string> lines = readAndRemoveLogs(strBase);
+  int nLast = 0;
+  for (const std::string& line : lines) {
+    EXPECT_EQ(line.rfind("[INFO][", 0), 0u);
+    if (line.find("]rolling seq=199 ") != std::string::npos) nLast++;
+  }
+  EXPECT_EQ(nLast, 1);
+}
+
+TEST(AsyncLogTest, DropNewestCountsDroppedLines) {
+  CAsyncLog::setQueueCapacity(16);
+  CAsyncLog::setQueuePolicy(LOG_QUEUE_DROP_NEWEST);
+  const uint64_t nBefore = CAsyncLog::droppedLines(LOG_LEVEL_INFO);
+  const std::string strOutput = logWithStalledWriter(false, []() {
+    for (int i = 0; i < 2000; i++) {
+      LOGI("stall seq=%d %s", i, kPadding.c_str());
+    }
+  });
+  CAsyncLog::setQueuePolicy(LOG_QUEUE_BLOCK);
+  CAsyncLog::setQueueCapacity(4096);
+
+  const uint64_t nDropped = CAsyncLog::droppedLines(LOG_LEVEL_INFO) - nBefore;
+  EXPECT_GT(nDropped, 0u);
+  EXPECT_EQ(countText(strOutput, "]stall seq="), 2000 - nDropped);
+  // 丢弃的是新日志，最早的一条还在
+  EXPECT_EQ(countText(strOutput, "]stall seq=0 "), 1);
+  EXPECT_EQ(summarizedDrops(strOutput), nDropped);
+  EXPECT_NE(strOutput.find(" lines: [INFO]"), std::string::npos);
+}
+
+TEST(AsyncLogTest, DropOldestKeepsNewestLines) {
+  CAsyncLog::setQueueCapacity(16);
+  CAsyncLog::setQueuePolicy(LOG_QUEUE_DROP_OLDEST);
+  const uint64_t nBefore = CAsyncLog::droppedLines(LOG_LEVEL_WARNING);
+  const std::string strOutput = logWithStalledWriter(false, []() {
+    for (int i = 0; i < 2000; i++) {
+      LOGW("stall seq=%d %s", i, kPadding.c_str());
+    }
+  });
+  CAsyncLog::setQueuePolicy(LOG_QUEUE_BLOCK);
+  CAsyncLog::setQueueCapacity(4096);
+
+  const uint64_t nDropped =
+      CAsyncLog::droppedLines(LOG_LEVEL_WARNING) - nBefore;
+  EXPECT_GT(nDropped, 0u);
+  EXPECT_EQ(countText(strOutput, "]stall seq="), 2000 - nDropped);
+  // 缓冲区里留下的是最新的日志
+  EXPECT_EQ(countText(strOutput, "]stall seq=1999 "), 1);
+  EXPECT_EQ(summarizedDrops(strOutput), nDropped);
+}
+
+TEST(AsyncLogTest, SampleKeepsEveryNthLineUnderPressure) {
+  CAsyncLog::setQueueCapacity(16);
+  CAsyncLog::setQueuePolicy(LOG_QUEUE_SAMPLE, 4);
+  const uint64_t nBefore = CAsyncLog::droppedLines(LOG_LEVEL_INFO);
+  const std::string strOutput = logWithStalledWriter(false, []() {
+    for (int i = 0; i < 2000; i++) {
+      LOGI("stall seq=%d %s", i, kPadding.c_str());
+    }
+  });
+  CAsyncLog::setQueuePolicy(LOG_QUEUE_BLOCK);
+  CAsyncLog::setQueueCapacity(4096);
+
+  const uint64_t nDropped = CAsyncLog::droppedLines(LOG_LEVEL_INFO) - nBefore;
+  EXPECT_GT(nDropped, 0u);
+  EXPECT_EQ(countText(strOutput, "]stall seq="), 2000 - nDropped);
+  EXPECT_EQ(summarizedDrops(strOutput), nDropped);
+}
+
+TEST(AsyncLogTest, CriticalLinesAreNeverDropped) {
+  CAsyncLog::setQueueCapacity(16);
+  CAsyncLog::setQueuePolicy(LOG_QUEUE_DROP_OLDEST);
+  const uint64_t nBefore = CAsyncLog::droppedLines(LOG_LEVEL_INFO);
+  // CRITICAL 日志在缓冲区满时等待，必须一边输出一边读管道
+  const std::string strOutput = logWithStalledWriter(true, []() {
+    for (int i = 0; i < 2000; i++) {
+      if (i % 10 == 0) {
+        LOGC("critical seq=%d %s", i, kPadding.c_str());
+      } else {
+        LOGI("stall seq=%d %s", i, kPadding.c_str());
+      }
+    }
+  });
+  CAsyncLog::setQueuePolicy(LOG_QUEUE_BLOCK);
+  CAsyncLog::setQueueCapacity(4096);
+
+  const uint64_t nDropped = CAsyncLog::droppedLines(LOG_LEVEL_INFO) - nBefore;
+  EXPECT_EQ(countText(strOutput, "]critical seq="), 200);
+  EXPECT_EQ(countText(strOutput, "]stall seq="), 1800 - nDropped);
+  EXPECT_EQ(CAsyncLog::droppedLines(LOG_LEVEL_CRITICAL), 0u);
+}
+
+TEST(AsyncLogTest, FullBufferCountsDropsWhileStopped) {
+  CAsyncLog::setQueueCapacity(16);
+  const uint64_t nBefore = CAsyncLog::droppedLines(LOG_LEVEL_INFO);
+  // 写线程没有运行时缓冲区写满后不再等待，多出的日志计入丢弃
+  std::thread([]() {
+    for (int i = 0; i < 100; i++) LOGI("stopped seq=%d", i);
+  }).join();
+  CAsyncLog::setQueueCapacity(4096);
+  EXPECT_EQ(CAsyncLog::droppedLines(LOG_LEVEL_INFO) - nBefore, 84u);
+
+  // 留在缓冲区里的日志和丢弃汇总在下次启动后写出
+  const std::string strOutput = logWithStalledWriter(true, []() {});
+  EXPECT_EQ(countText(strOutput, "]stopped seq="), 16);
+  EXPECT_EQ(summarizedDrops(strOutput), 84u);
+}
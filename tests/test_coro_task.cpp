@@ -0,0 +1,98 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <future>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "playground/threading/coro_task.hpp"
+#include "playground/threading/thread_pool.h"
+
+using namespace playground;
+
+namespace {
+Task<std::thread::id> currentThreadOn(ThreadPool& pool) {
+  co_await pool.schedule();
+  co_return std::this_thread::get_id();
+}
+
+Task<int> square(int value) { co_return value * value; }
+
+Task<long> useCount(std::shared_ptr<int> token) { co_return token.use_count(); }
+
+Task<int> sumOfSquares(int count) {
+  int total = 0;
+  for (int i = 1; i <= count; i++) total += co_await square(i);
+  co_return total;
+}
+
+Task<> failing() {
+  throw std::runtime_error("boom");
+  co_return;
+}
+
+// 在唯一的工作线程上等待另一个池任务：若阻塞等待就会死锁
+Task<std::string> handler(ThreadPool& pool, int id) {
+  co_await pool.schedule();
+  const int backend = co_await pool.addTask([id] { return id * 2; });
+  co_return "request " + std::to_string(id) + " -> " +
+      std::to_string(backend);
+}
+}  // namespace
+
+TEST(CoroTaskTest, ScheduleResumesOnWorker) {
+  ThreadPool pool(2);
+  EXPECT_NE(spawn(pool, currentThreadOn(pool)).get(),
+            std::this_thread::get_id());
+}
+
+TEST(CoroTaskTest, TasksAwaitOtherTasks) {
+  ThreadPool pool(2);
+  EXPECT_EQ(spawn(pool, sumOfSquares(10)).get(), 385);
+}
+
+TEST(CoroTaskTest, ExceptionsReachTheAwaiter) {
+  ThreadPool pool(1);
+  EXPECT_THROW(spawn(pool, failing()).get(), std::runtime_error);
+}
+
+TEST(CoroTaskTest, AwaitingFutureDoesNotHoldWorker) {
+  ThreadPool pool(1);
+  std::vector<TaskFuture<std::string>> results;
+  for (int i = 0; i < 50; i++) results.push_back(spawn(pool, handler(pool, i)));
+  for (int i = 0; i < 50; i++) {
+    EXPECT_EQ(results[i].get(),
+              "request " + std::to_string(i) + " -> " + std::to_string(i * 2));
+  }
+}
+
+TEST(CoroTaskTest, SpawnOnStoppedPoolFails) {
+  ThreadPool pool(1);
+  pool.stop();
+  EXPECT_THROW(spawn(pool, square(3)).get(), std::logic_error);
+}
+
+TEST(CoroTaskTest, SpawnDroppedByAbortBreaksPromise) {
+  ThreadPool pool(1);
+  std::promise<void> release;
+  auto gate = release.get_future().share();
+  std::promise<void> started;
+  auto blocker = pool.addTask([gate, &started] {
+    started.set_value();
+    gate.wait();
+  });
+  started.get_future().wait();
+
+  // 启动任务还在队列中就被丢弃：协程帧连同其中的 task 一起销毁
+  auto token = std::make_shared<int>(0);
+  auto result = spawn(pool, useCount(token));
+  EXPECT_EQ(token.use_count(), 2);
+  pool.abort();
+  EXPECT_THROW(result.get(), std::future_error);
+  EXPECT_EQ(token.use_count(), 1);
+  release.set_value();
+  blocker.get();
+}
@@ -0,0 +1,27 @@
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "playground/threading/cpu_topology.h"
+
+using namespace playground;
+
+TEST(CpuTopologyTest, ParsesCpuList) {
+  EXPECT_EQ(parseCpuList("0-3,8,10-11\n"),
+            (std::vector<unsigned int>{0, 1, 2, 3, 8, 10, 11}));
+  EXPECT_EQ(parseCpuList("5"), (std::vector<unsigned int>{5}));
+  EXPECT_TRUE(parseCpuList("").empty());
+  EXPECT_TRUE(parseCpuList("\n").empty());
+  // 区间倒置视为格式错误，只保留此前解析出的部分
+  EXPECT_EQ(parseCpuList("1,4-2"), (std::vector<unsigned int>{1}));
+}
+
+TEST(CpuTopologyTest, DetectsAtLeastOneNode) {
+  const CpuTopology topology = CpuTopology::detect();
+  ASSERT_FALSE(topology.nodes.empty());
+  EXPECT_GT(topology.cpuCount(), 0u);
+  for (size_t node = 0; node < topology.nodes.size(); node++) {
+    ASSERT_FALSE(topology.nodes[node].empty());
+    EXPECT_EQ(topology.nodeOf(topology.nodes[node].front()), node);
+  }
+}
@@ -0,0 +1,84 @@
+// 这个文件把编译期最低级别设为 INFO，检查更低级别的调用被整个去掉
+#define PLAYGROUND_LOG_MIN_LEVEL LOG_LEVEL_INFO
+
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "playground/threading/async_log.h"
+#include "playground/threading/log_format.hpp"
+
+using namespace playground;
+
+namespace {
+template <typename... Args>
+std::string format(LogFormatString<Args...> fmt, Args&&... args) {
+  std::string strOut = "x";
+  formatLogMessage(strOut, fmt, std::forward<Args>(args)...);
+  return strOut.substr(1);
+}
+
+int g_nEvaluated = 0;
+int countEvaluation() { return ++g_nEvaluated; }
+}  // namespace
+
+TEST(LogFormatTest, FormatsLikeStdFormat) {
+  EXPECT_EQ(format("x={} y={}", 1, -2), "x=1 y=-2");
+  EXPECT_EQ(format("{} {} {}", 3000000000u, -9223372036854775807ll - 1,
+                   18446744073709551615ull),
+            "3000000000 -9223372036854775808 18446744073709551615");
+  EXPECT_EQ(format("{} {} {}", 0.1, 1.5f, 1e100), "0.1 1.5 1e+100");
+  EXPECT_EQ(format("{} {}", true, 'c'), "true c");
+  const std::string strName = "alice";
+  EXPECT_EQ(format("{}/{}/{}", "literal", strName, std::string_view("view")),
+            "literal/alice/view");
+  EXPECT_EQ(format("{} {}", nullptr, static_cast<const void*>(nullptr)),
+            "0x0 0x0");
+  EXPECT_EQ(format("{{{}}} }}{{", 5), "{5} }{");
+  EXPECT_EQ(format("no fields"), "no fields");
+}
+
+TEST(LogFormatTest, WritesLines) {
+  const std::string strBase =
+      "/tmp/playground_log_format_" + std::to_string(::getpid());
+  CAsyncLog::setConsoleEcho(false);
+  ASSERT_TRUE(CAsyncLog::init(strBase.c_str()));
+  for (int i = 0; i < 3; i++) FLOGI("user={} seq={}", "alice", i);
+  FLOGW("done");
+  CAsyncLog::uninit();
+  CAsyncLog::setConsoleEcho(true);
+
+  namespace fs = std::filesystem;
+  std::vector<std::string> lines;
+  for (const auto& entry : fs::directory_iterator("/tmp")) {
+    const std::string name = entry.path().filename().string();
+    if (name.rfind(fs::path(strBase).filename().string(), 0) != 0) continue;
+    std::ifstream in(entry.path());
+    for (std::string line; std::getline(in, line);) lines.push_back(line);
+    in.close();
+    fs::remove(entry.path());
+  }
+  ASSERT_EQ(lines.size(), 4u);
+  EXPECT_EQ(lines[0].rfind("[INFO][", 0), 0u);
+  EXPECT_NE(lines[0].find("test_log_format.cpp:"), std::string::npos);
+  EXPECT_NE(lines[2].find("]user=alice seq=2"), std::string::npos);
+  EXPECT_EQ(lines[3].rfind("[WARN][", 0), 0u);
+}
+
+TEST(LogFormatTest, LevelsBelowMinimumCompileAway) {
+  g_nEvaluated = 0;
+  // 写线程没有运行，能通过编译期过滤的调用只会留在缓冲区里
+  LOGD("%d", countEvaluation());
+  DLOGT("%d", countEvaluation());
+  FLOGD("{}", countEvaluation());
+  EXPECT_EQ(g_nEvaluated, 0);
+
+  LOGI("%d", countEvaluation());
+  DLOGI("%d", countEvaluation());
+  FLOGI("{}", countEvaluation());
+  EXPECT_EQ(g_nEvaluated, 3);
+}
@@ -0,0 +1,169 @@
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <ctime>
+#include <iterator>
+#include <string>
+
+#include "playground/threading/async_log.h"
+#include "playground/threading/log_record.h"
+
+using namespace playground;
+
+namespace {
+// 编码参数后按格式串还原，与 snprintf 的结果比较
+template <typename... Args>
+std::string formatDeferred(const char* pszFmt, const Args&... args) {
+  std::string strArgs((size_t{0} + ... + encodedLogArgSize(args)), '\0');
+  char* p = strArgs.data();
+  ((p = encodeLogArg(p, args)), ...);
+  EXPECT_EQ(p, strArgs.data() + strArgs.size());
+
+  std::string strOut;
+  formatLogArgs(pszFmt, strArgs.data(), strArgs.size(), strOut);
+  return strOut;
+}
+
+template <typename... Args>
+std::string formatPrintf(const char* pszFmt, const Args&... args) {
+  char szBuf[256];
+  snprintf(szBuf, sizeof(szBuf), pszFmt, args...);
+  return szBuf;
+}
+
+std::string makeRecord(uint32_t nFormatId, uint64_t nTimeUs,
+                       uint64_t nThreadId, int nValue) {
+  std::string strRecord(kLogRecordHeaderSize + encodedLogArgSize(nValue),
+                        '\0');
+  memcpy(&strRecord[0], &nFormatId, 4);
+  memcpy(&strRecord[4], &nTimeUs, 8);
+  memcpy(&strRecord[12], &nThreadId, 8);
+  encodeLogArg(&strRecord[kLogRecordHeaderSize], nValue);
+  return strRecord;
+}
+}  // namespace
+
+#define EXPECT_SAME_AS_PRINTF(fmt, ...) \
+  EXPECT_EQ(formatDeferred(fmt, __VA_ARGS__), formatPrintf(fmt, __VA_ARGS__))
+
+TEST(LogRecordTest, MatchesPrintf) {
+  EXPECT_SAME_AS_PRINTF("id=%d name=%s", 42, "alice");
+  EXPECT_SAME_AS_PRINTF("[%5d|%-5d|%05d]", -7, 8, 9);
+  EXPECT_SAME_AS_PRINTF("%u %x %X %o", 3000000000u, -1, 255u, 8);
+  EXPECT_SAME_AS_PRINTF("%lld %llu %llx", -1ll, ~0ull, 0xabcdefull);
+  EXPECT_SAME_AS_PRINTF("%zu %ld", sizeof(int), 123456789l);
+  EXPECT_SAME_AS_PRINTF("%.3f %10.2e %g", 3.14159, 12345.678, 0.5f);
+  EXPECT_SAME_AS_PRINTF("%c%c %hd %hhu", 'o', 'k', short(-3), (unsigned char)7);
+  EXPECT_SAME_AS_PRINTF("%*d|%-*s|%.*s", 6, 1, 4, "ab", 2, "xyz");
+  EXPECT_SAME_AS_PRINTF("100%% %s", "done");
+  EXPECT_SAME_AS_PRINTF("%p", static_cast<void*>(nullptr));
+  int nValue = 0;
+  EXPECT_SAME_AS_PRINTF("%p", static_cast<void*>(&nValue));
+  EXPECT_EQ(formatDeferred("no args"), "no args");
+  EXPECT_EQ(formatDeferred("%s", static_cast<const char*>(nullptr)), "(null)");
+}
+
+TEST(LogRecordTest, MismatchedArgumentsAreMarked) {
+  EXPECT_EQ(formatDeferred("%s", 1), "<?>");
+  EXPECT_EQ(formatDeferred("%d %d", 1), "1 <?>");
+  EXPECT_EQ(formatDeferred("%f", 1), "<?>");
+}
+
+TEST(LogRecordTest, PrefixMatchesLocalTime) {
+  // 秒和线程号来回切换，缓存的内容必须跟着更新
+  const uint64_t nBaseUs = 1700000000ull * 1000000;
+  const struct {
+    long nLevel;
+    uint64_t nTimeUs;
+    uint64_t nThreadId;
+  } cases[] = {
+      {LOG_LEVEL_ERROR, nBaseUs + 7000, 1},
+      {LOG_LEVEL_ERROR, nBaseUs + 999999, 1},
+      {LOG_LEVEL_TRACE, nBaseUs + 1000000 + 42000, 2},
+      {LOG_LEVEL_CRITICAL, nBaseUs, 1},
+      {42, nBaseUs + 3600000000ull + 123456, 1234567890123ull},
+  };
+  const char* pszTags[] = {"[ERROR]", "[ERROR]", "[TRACE]", "[CRITICAL]",
+                           "[INFO]"};
+  for (size_t i = 0; i < std::size(cases); i++) {
+    const time_t now = static_cast<time_t>(cases[i].nTimeUs / 1000000);
+    tm time;
+    localtime_r(&now, &time);
+    char szExpected[128];
+    snprintf(szExpected, sizeof(szExpected),
+             "%s[[%04d-%02d-%02d %02d:%02d:%02d:%03d]][%llu]", pszTags[i],
+             time.tm_year + 1900, time.tm_mon + 1, time.tm_mday, time.tm_hour,
+             time.tm_min, time.tm_sec,
+             static_cast<int>(cases[i].nTimeUs / 1000 % 1000),
+             static_cast<unsigned long long>(cases[i].nThreadId));
+
+    std::string strPrefix = "x";
+    appendLogPrefix(strPrefix, cases[i].nLevel, cases[i].nTimeUs,
+                    cases[i].nThreadId);
+    EXPECT_EQ(strPrefix, std::string("x") + szExpected);
+  }
+}
+
+TEST(LogRecordTest, DecoderHandlesPartialFrames) {
+  static const LogFormatInfo info{LOG_LEVEL_WARNING, "server.cpp", 42,
+                                  "value=%d"};
+  std::string strData;
+  appendLogFrame(strData, LOG_FRAME_TEXT, "plain line\n", 11);
+  appendLogFormatFrame(strData, 3, info);
+  const std::string strRecord = makeRecord(3, 0, 77, 5);
+  appendLogFrame(strData, LOG_FRAME_RECORD, strRecord.data(),
+                 strRecord.size());
+
+  // 一次解码全部数据
+  std::string strExpected;
+  {
+    LogDecoder decoder;
+    EXPECT_EQ(decoder.decode(strData.data(), strData.size(), strExpected),
+              strData.size());
+  }
+  EXPECT_EQ(strExpected.rfind("plain line\n[WARN][", 0), 0u);
+  EXPECT_NE(strExpected.find("[77][server.cpp:42]value=5\n"),
+            std::string::npos);
+
+  // 逐字节喂给解码器，结果相同
+  LogDecoder decoder;
+  std::string strPending;
+  std::string strText;
+  for (char c : strData) {
+    strPending += c;
+    strPending.erase(
+        0, decoder.decode(strPending.data(), strPending.size(), strText));
+  }
+  EXPECT_TRUE(strPending.empty());
+  EXPECT_EQ(strText, strExpected);
+}
+
+TEST(LogRecordTest, DecoderRejectsUnknownFormat) {
+  const std::string strRecord = makeRecord(9, 0, 1, 5);
+  std::string strData;
+  appendLogFrame(strData, LOG_FRAME_RECORD, strRecord.data(),
+                 strRecord.size());
+  LogDecoder decoder;
+  std::string strText;
+  EXPECT_THROW(decoder.decode(strData.data(), strData.size(), strText),
+               std::runtime_error);
+}
+
+TEST(LogRecordTest, DecoderStopsAtZeroPadding) {
+  // 程序崩溃后，映射文件末尾留有预分配的 0
+  std::string strData;
+  appendLogFrame(strData, LOG_FRAME_TEXT, "last line\n", 10);
+  const size_t nFrames = strData.size();
+  strData.append(4096, '\0');
+
+  LogDecoder decoder;
+  std::string strText;
+  EXPECT_EQ(decoder.decode(strData.data(), strData.size(), strText),
+            strData.size());
+  EXPECT_EQ(strText, "last line\n");
+
+  // 填充少于一个帧头时同样全部用掉
+  strText.clear();
+  EXPECT_EQ(decoder.decode(strData.data(), nFrames + 2, strText), nFrames + 2);
+  EXPECT_EQ(strText, "last line\n");
+}
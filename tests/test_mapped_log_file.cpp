@@ -0,0 +1,86 @@
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <utility>
+
+#include "playground/threading/mapped_log_file.h"
+
+using namespace playground;
+
+namespace {
+std::string tempPath(const char* pszName) {
+  return "/tmp/playground_mapped_log_" + std::to_string(::getpid()) + "_" +
+         pszName;
+}
+
+std::string readFile(const std::string& strPath) {
+  std::ifstream in(strPath, std::ios::binary);
+  return std::string((std::istreambuf_iterator<char>(in)),
+                     std::istreambuf_iterator<char>());
+}
+}  // namespace
+
+TEST(MappedLogFileTest, PreallocatesGrowsAndTruncates) {
+  namespace fs = std::filesystem;
+  const std::string strPath = tempPath("grow");
+  MappedLogFile file;
+  ASSERT_TRUE(file.open(strPath, 16));
+  EXPECT_EQ(fs::file_size(strPath), 16u);
+
+  ASSERT_TRUE(file.write("0123456789", 10));
+  // 写入后不需要关闭，其他读者就能看到
+  EXPECT_EQ(readFile(strPath).substr(0, 10), "0123456789");
+  // 超出预分配的大小时扩展
+  ASSERT_TRUE(file.write("abcdefghijklmnopqrst", 20));
+  EXPECT_EQ(file.size(), 30u);
+  EXPECT_GE(fs::file_size(strPath), 30u);
+
+  file.close();
+  EXPECT_FALSE(file.isOpen());
+  EXPECT_EQ(readFile(strPath), "0123456789abcdefghijklmnopqrst");
+  fs::remove(strPath);
+}
+
+TEST(MappedLogFileTest, RenameKeepsMapping) {
+  namespace fs = std::filesystem;
+  const std::string strNext = tempPath("next");
+  const std::string strFinal = tempPath("final");
+  MappedLogFile next;
+  ASSERT_TRUE(next.open(strNext, 4096));
+  ASSERT_TRUE(next.write("before ", 7));
+  ASSERT_TRUE(next.rename(strFinal));
+  EXPECT_EQ(next.path(), strFinal);
+
+  // 移动后由新对象负责关闭
+  MappedLogFile file = std::move(next);
+  EXPECT_FALSE(next.isOpen());
+  ASSERT_TRUE(file.write("after", 5));
+  file.close();
+  EXPECT_FALSE(fs::exists(strNext));
+  EXPECT_EQ(readFile(strFinal), "before after");
+  fs::remove(strFinal);
+}
+
+TEST(MappedLogFileTest, DiscardRemovesFile) {
+  const std::string strPath = tempPath("discard");
+  {
+    MappedLogFile file;
+    ASSERT_TRUE(file.open(strPath, 4096));
+    file.discard();
+    EXPECT_FALSE(file.isOpen());
+  }
+  EXPECT_FALSE(std::filesystem::exists(strPath));
+
+  // 析构时关闭并截断
+  {
+    MappedLogFile file;
+    ASSERT_TRUE(file.open(strPath, 4096));
+    ASSERT_TRUE(file.write("line\n", 5));
+  }
+  EXPECT_EQ(readFile(strPath), "line\n");
+  std::filesystem::remove(strPath);
+}
@@ -0,0 +1,75 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "playground/threading/mpmc_ring.hpp"
+
+using namespace playground;
+
+TEST(MpmcRingTest, PushPopInOrder) {
+  MpmcRing<int> ring(3);
+  EXPECT_EQ(ring.capacity(), 4u);
+  EXPECT_TRUE(ring.empty());
+
+  int value = 0;
+  EXPECT_FALSE(ring.try_pop(value));
+  for (int i = 0; i < 4; i++) EXPECT_TRUE(ring.try_push(int(i)));
+  EXPECT_FALSE(ring.try_push(4));
+  for (int i = 0; i < 4; i++) {
+    ASSERT_TRUE(ring.try_pop(value));
+    EXPECT_EQ(value, i);
+  }
+  EXPECT_TRUE(ring.empty());
+
+  // 绕回之后槽位可以继续复用
+  for (int round = 0; round < 10; round++) {
+    EXPECT_TRUE(ring.try_push(int(round)));
+    ASSERT_TRUE(ring.try_pop(value));
+    EXPECT_EQ(value, round);
+  }
+}
+
+TEST(MpmcRingTest, FailedPushKeepsValue) {
+  MpmcRing<std::unique_ptr<int>> ring(2);
+  EXPECT_TRUE(ring.try_push(std::make_unique<int>(1)));
+  EXPECT_TRUE(ring.try_push(std::make_unique<int>(2)));
+  auto extra = std::make_unique<int>(3);
+  EXPECT_FALSE(ring.try_push(std::move(extra)));
+  ASSERT_TRUE(extra);
+  EXPECT_EQ(*extra, 3);
+}
+
+TEST(MpmcRingTest, ConcurrentProducersAndConsumers) {
+  constexpr int kThreads = 4;
+  constexpr int kPerThread = 20000;
+  MpmcRing<int> ring(64);
+  std::atomic<long long> sum{0};
+  std::atomic<int> consumed{0};
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreads; t++) {
+    threads.emplace_back([&ring] {
+      for (int i = 1; i <= kPerThread; i++) {
+        while (!ring.try_push(int(i))) std::this_thread::yield();
+      }
+    });
+    threads.emplace_back([&] {
+      int value = 0;
+      while (consumed.load() < kThreads * kPerThread) {
+        if (ring.try_pop(value)) {
+          sum.fetch_add(value);
+          consumed.fetch_add(1);
+        } else {
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+  for (auto& th : threads) th.join();
+
+  EXPECT_EQ(sum.load(), 1LL * kThreads * kPerThread * (kPerThread + 1) / 2);
+  EXPECT_TRUE(ring.empty());
+}
@@ -0,0 +1,169 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "playground/threading/strand.h"
+#include "playground/threading/thread_pool.h"
+
+using namespace playground;
+
+TEST(StrandTest, RunsTasksSeriallyInOrder) {
+  ThreadPool pool(4);
+  Strand strand(pool);
+  std::vector<int> order;  // 只在 strand 上访问，不加锁
+  std::atomic<int> inside{0};
+  std::atomic<bool> overlapped{false};
+  for (int i = 0; i < 1000; i++) {
+    strand.execute([&, i] {
+      if (inside.fetch_add(1) != 0) overlapped = true;
+      order.push_back(i);
+      inside.fetch_sub(1);
+    });
+  }
+  // 任务按提交顺序执行，最后一个任务完成时前面的都已完成
+  EXPECT_EQ(strand.addTask([&order] { return order.size(); }).get(), 1000u);
+  EXPECT_FALSE(overlapped.load());
+  for (int i = 0; i < 1000; i++) ASSERT_EQ(order[i], i);
+}
+
+TEST(StrandTest, DifferentStrandsRunInParallel) {
+  ThreadPool pool(2);
+  Strand first(pool);
+  Strand second(pool);
+  // 两个任务互相等待对方开始，只有并行执行才能完成
+  std::promise<void> first_started;
+  std::promise<void> second_started;
+  auto a = first.addTask([&] {
+    first_started.set_value();
+    second_started.get_future().wait();
+  });
+  auto b = second.addTask([&] {
+    second_started.set_value();
+    first_started.get_future().wait();
+  });
+  a.get();
+  b.get();
+}
+
+TEST(StrandTest, BatchesQueuedTasksIntoOnePoolJob) {
+  ThreadPool pool(2);
+  Strand strand(pool);
+  std::promise<void> release;
+  auto gate = release.get_future().share();
+  std::promise<void> started;
+  strand.execute([gate, &started] {
+    started.set_value();
+    gate.wait();
+  });
+  started.get_future().wait();
+  // 第一个批次运行期间积压的任务在下一个批次中一起执行
+  std::atomic<int> counter{0};
+  for (int i = 0; i < 100; i++) {
+    strand.execute([&counter] { counter.fetch_add(1); });
+  }
+  auto last = strand.addTask([] {});
+  release.set_value();
+  last.get();
+  EXPECT_EQ(counter.load(), 100);
+
+  // 池任务计数在任务返回后才更新
+  std::uint64_t jobs = 0;
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  do {
+    jobs = 0;
+    for (const auto& worker : pool.snapshot().workers) jobs += worker.tasks;
+  } while (jobs < 2 && std::chrono::steady_clock::now() < deadline);
+  EXPECT_EQ(jobs, 2u);
+}
+
+TEST(StrandTest, WorksAsContinuationExecutor) {
+  ThreadPool pool(2);
+  Strand strand(pool);
+  auto fut = pool.addTask([] { return 20; })
+                 .then(strand, [](TaskFuture<int> v) { return v.get() + 1; });
+  EXPECT_EQ(fut.get(), 21);
+}
+
+TEST(StrandTest, PostAfterStopThrows) {
+  ThreadPool pool(1);
+  Strand strand(pool);
+  pool.stop();
+  EXPECT_THROW(strand.execute([] {}), std::logic_error);
+  // 失败的提交不会让 strand 卡在已调度状态
+  EXPECT_THROW(strand.execute([] {}), std::logic_error);
+}
+
+TEST(StrandTest, GroupSerializesPerKey) {
+  ThreadPool pool(4);
+  StrandGroup<std::string> group(pool, 8);
+  std::vector<int> counts(2);  // 每个键的计数只在该键的 strand 上修改
+  const std::string keys[] = {"alice", "bob"};
+  std::vector<TaskFuture<void>> futs;
+  for (int i = 0; i < 1000; i++) {
+    const int k = i % 2;
+    futs.push_back(group.addTask(keys[k], [&counts, k] { counts[k]++; }));
+  }
+  for (auto& fut : futs) fut.get();
+  if (&group.strandFor(keys[0]) == &group.strandFor(keys[1])) {
+    EXPECT_EQ(counts[0] + counts[1], 1000);
+  } else {
+    EXPECT_EQ(counts[0], 500);
+    EXPECT_EQ(counts[1], 500);
+  }
+}
+
+namespace {
+ThreadPoolOptions rejectingRing() {
+  ThreadPoolOptions options;
+  options.backend = QueueBackend::kLockFreeRing;
+  options.queue_capacity = 2;
+  options.overflow = OverflowPolicy::kReject;
+  return options;
+}
+}  // namespace
+
+TEST(StrandTest, RejectedPostFailsOnlyThatTask) {
+  ThreadPool pool(rejectingRing());
+  std::promise<void> release;
+  auto gate = release.get_future().share();
+  std::promise<void> started;
+  auto blocker = pool.addTask(TaskPriority::kHigh, [gate, &started] {
+    started.set_value();
+    gate.wait();
+  });
+  started.get_future().wait();
+  auto a = pool.addTask([] {});
+  auto b = pool.addTask([] {});
+
+  // 队列暂时已满只拒绝本次提交，strand 之后仍可使用
+  Strand strand(pool);
+  EXPECT_THROW(strand.execute([] {}), std::overflow_error);
+  release.set_value();
+  blocker.get();
+  EXPECT_EQ(strand.addTask([] { return 3; }).get(), 3);
+}
+
+TEST(StrandTest, RejectedRepostKeepsDraining) {
+  ThreadPool pool(rejectingRing());
+  Strand strand(pool);
+  std::promise<void> release;
+  auto gate = release.get_future().share();
+  std::promise<void> started;
+  strand.execute([gate, &started] {
+    started.set_value();
+    gate.wait();
+  });
+  started.get_future().wait();
+  auto queued = strand.addTask([] { return 1; });
+  // 批次结束时队列已满，无法重新排队，剩余的任务在当前线程继续执行
+  auto a = pool.addTask([] {});
+  auto b = pool.addTask([] {});
+  release.set_value();
+  EXPECT_EQ(queued.get(), 1);
+  EXPECT_EQ(strand.addTask([] { return 2; }).get(), 2);
+}
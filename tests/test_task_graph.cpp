@@ -0,0 +1,152 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <future>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+#include "playground/threading/task_graph.h"
+#include "playground/threading/thread_pool.h"
+
+using namespace playground;
+
+TEST(TaskGraphTest, RunsInDependencyOrder) {
+  ThreadPool pool(4);
+  std::mutex mtx;
+  std::vector<char> order;
+  auto record = [&](char name) {
+    return [&, name] {
+      std::lock_guard<std::mutex> lock(mtx);
+      order.push_back(name);
+    };
+  };
+
+  // 菱形依赖：a -> {b, c} -> d
+  TaskGraph graph;
+  const auto a = graph.add(record('a'));
+  const auto b = graph.add(record('b'));
+  const auto c = graph.add(record('c'));
+  const auto d = graph.add(record('d'));
+  graph.precede(a, b);
+  graph.precede(a, c);
+  graph.precede(b, d);
+  graph.precede(c, d);
+
+  for (int round = 0; round < 3; round++) {
+    order.clear();
+    graph.run(pool).wait();
+    ASSERT_EQ(order.size(), 4u);
+    EXPECT_EQ(order.front(), 'a');
+    EXPECT_EQ(order.back(), 'd');
+  }
+}
+
+TEST(TaskGraphTest, WideGraphOnSingleThreadDoesNotBlock) {
+  // 单线程池：若后继任务在工作线程里等待前驱就会死锁
+  ThreadPool pool(1);
+  std::atomic<int> counter{0};
+  TaskGraph graph;
+  const auto sink = graph.add([&counter] { counter.fetch_add(1000); });
+  for (int i = 0; i < 100; i++) {
+    const auto head = graph.add([&counter] { counter.fetch_add(1); });
+    const auto tail = graph.add([&counter] { counter.fetch_add(1); });
+    graph.precede(head, tail);
+    graph.precede(tail, sink);
+  }
+  graph.run(pool).wait();
+  EXPECT_EQ(counter.load(), 1200);
+}
+
+TEST(TaskGraphTest, FailureSkipsRemainingNodes) {
+  ThreadPool pool(2);
+  std::atomic<bool> ran{false};
+  TaskGraph graph;
+  const auto bad = graph.add([] { throw std::runtime_error("boom"); });
+  const auto after = graph.add([&ran] { ran = true; });
+  graph.precede(bad, after);
+  EXPECT_THROW(graph.run(pool).wait(), std::runtime_error);
+  EXPECT_FALSE(ran.load());
+}
+
+TEST(TaskGraphTest, RejectsCycles) {
+  ThreadPool pool(1);
+  TaskGraph graph;
+  const auto a = graph.add([] {});
+  const auto b = graph.add([] {});
+  graph.precede(a, b);
+  graph.precede(b, a);
+  EXPECT_THROW(graph.run(pool), std::logic_error);
+  EXPECT_THROW(graph.precede(a, 7), std::out_of_range);
+}
+
+namespace {
+ThreadPoolOptions rejectingRing() {
+  ThreadPoolOptions options;
+  options.backend = QueueBackend::kLockFreeRing;
+  options.queue_capacity = 2;
+  options.overflow = OverflowPolicy::kReject;
+  return options;
+}
+}  // namespace
+
+TEST(TaskGraphTest, RejectedSuccessorRunsInline) {
+  ThreadPool pool(rejectingRing());
+  std::atomic<int> counter{0};
+  TaskGraph graph;
+  // 根节点占满队列，提交后继时被拒绝
+  const auto head = graph.add([&pool] {
+    pool.execute([] {});
+    pool.execute([] {});
+  });
+  const auto tail = graph.add([&counter] { counter.fetch_add(1); });
+  graph.precede(head, tail);
+  graph.run(pool).wait();
+  EXPECT_EQ(counter.load(), 1);
+}
+
+TEST(TaskGraphTest, RejectedRootRunsInline) {
+  ThreadPool pool(rejectingRing());
+  std::promise<void> release;
+  auto gate = release.get_future().share();
+  std::promise<void> started;
+  auto blocker = pool.addTask(TaskPriority::kHigh, [gate, &started] {
+    started.set_value();
+    gate.wait();
+  });
+  started.get_future().wait();
+  pool.execute([] {});
+
+  // 第一个根节点排队后队列已满，第二个根节点不能让 run() 抛出
+  std::atomic<int> counter{0};
+  TaskGraph graph;
+  const auto first = graph.add([&counter] { counter.fetch_add(1); });
+  const auto second = graph.add([&counter] { counter.fetch_add(10); });
+  const auto sink = graph.add([&counter] { counter.fetch_add(100); });
+  graph.precede(first, sink);
+  graph.precede(second, sink);
+  auto handle = graph.run(pool);
+  EXPECT_EQ(counter.load(), 10);
+  release.set_value();
+  blocker.get();
+  handle.wait();
+  EXPECT_EQ(counter.load(), 111);
+
+  // 线程池已满时第一个根节点就提交失败：异常抛给调用者，没有任务被提交
+  ThreadPool full(rejectingRing());
+  std::promise<void> release_full;
+  auto gate_full = release_full.get_future().share();
+  std::promise<void> started_full;
+  auto blocker_full =
+      full.addTask(TaskPriority::kHigh, [gate_full, &started_full] {
+        started_full.set_value();
+        gate_full.wait();
+      });
+  started_full.get_future().wait();
+  full.execute([] {});
+  full.execute([] {});
+  EXPECT_THROW(graph.run(full), std::overflow_error);
+  release_full.set_value();
+  blocker_full.get();
+  EXPECT_EQ(counter.load(), 111);
+}
@@ -0,0 +1,794 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <future>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "playground/threading/cpu_topology.h"
+#include "playground/threading/thread_pool.h"
+
+using namespace playground;
+
+TEST(ThreadPoolTest, ReturnsResults) {
+  ThreadPool pool(4);
+  auto f1 = pool.addTask([](int a, int b) { return a + b; }, 1, 2);
+  auto f2 = pool.addTask([] { return std::string("pool"); });
+  EXPECT_EQ(f1.get(), 3);
+  EXPECT_EQ(f2.get(), "pool");
+}
+
+TEST(ThreadPoolTest, PropagatesException) {
+  ThreadPool pool(2);
+  auto fut = pool.addTask([]() -> int { throw std::runtime_error("boom"); });
+  EXPECT_THROW(fut.get(), std::runtime_error);
+}
+
+TEST(ThreadPoolTest, RunsAllExternalTasks) {
+  std::atomic<int> counter{0};
+  {
+    ThreadPool pool(4);
+    for (int i = 0; i < 10000; i++) {
+      pool.addTask([&counter] { counter.fetch_add(1); });
+    }
+  }
+  // 析构时 stop() 会执行完所有已提交的任务
+  EXPECT_EQ(counter.load(), 10000);
+}
+
+TEST(ThreadPoolTest, NestedTasksArePushedLocally) {
+  std::atomic<int> counter{0};
+  {
+    ThreadPool pool(4);
+    std::vector<TaskFuture<void>> futs;
+    for (int i = 0; i < 8; i++) {
+      futs.push_back(pool.addTask([&pool, &counter] {
+        for (int j = 0; j < 100; j++) {
+          pool.addTask([&counter] { counter.fetch_add(1); });
+        }
+      }));
+    }
+    for (auto& fut : futs) fut.get();
+  }
+  EXPECT_EQ(counter.load(), 800);
+}
+
+TEST(ThreadPoolTest, IdleWorkerStealsFromBusyWorker) {
+  ThreadPool pool(2);
+  // 内层任务进入外层任务所在线程的本地队列，外层阻塞等待时只能被另一个线程窃取
+  auto outer = pool.addTask([&pool] {
+    auto inner = pool.addTask([] { return std::this_thread::get_id(); });
+    return inner.get() != std::this_thread::get_id();
+  });
+  EXPECT_TRUE(outer.get());
+}
+
+TEST(ThreadPoolTest, AddTaskAfterStopThrows) {
+  ThreadPool pool(1);
+  pool.stop();
+  EXPECT_THROW(pool.addTask([] {}), std::logic_error);
+}
+
+TEST(ThreadPoolTest, AbortDropsQueuedTasks) {
+  ThreadPool pool(1);
+  std::promise<void> release;
+  auto gate = release.get_future().share();
+  std::promise<void> started;
+  auto blocker = pool.addTask([gate, &started] {
+    started.set_value();
+    gate.wait();
+  });
+  started.get_future().wait();
+  auto dropped = pool.addTask([] { return 1; });
+
+  pool.abort();
+  release.set_value();
+  blocker.get();
+  EXPECT_THROW(dropped.get(), std::future_error);
+}
+
+TEST(ThreadPoolTest, AddTasksRunsWholeBatch) {
+  ThreadPool pool(4);
+  std::atomic<int> counter{0};
+  std::vector<std::function<void()>> tasks(
+      1000, [&counter] { counter.fetch_add(1); });
+  auto handle = pool.addTasks(tasks);
+  handle.wait();
+  EXPECT_TRUE(handle.done());
+  EXPECT_EQ(counter.load(), 1000);
+}
+
+TEST(ThreadPoolTest, AddTasksFromWorker) {
+  ThreadPool pool(2);
+  std::atomic<int> counter{0};
+  auto outer = pool.addTask([&] {
+    std::vector<std::function<void()>> tasks(
+        100, [&counter] { counter.fetch_add(1); });
+    return pool.addTasks(tasks);
+  });
+  outer.get().wait();
+  EXPECT_EQ(counter.load(), 100);
+}
+
+TEST(ThreadPoolTest, EmptyBatchIsDone) {
+  ThreadPool pool(2);
+  std::vector<std::function<void()>> tasks;
+  auto handle = pool.addTasks(tasks);
+  EXPECT_TRUE(handle.done());
+  handle.wait();
+
+  auto range = pool.parallelFor(10, 10, 4, [](int) {});
+  EXPECT_TRUE(range.done());
+}
+
+TEST(ThreadPoolTest, ParallelForVisitsEveryIndexOnce) {
+  ThreadPool pool(4);
+  std::vector<std::atomic<int>> hits(10007);
+  auto handle = pool.parallelFor<size_t>(0, hits.size(), 64,
+                                         [&hits](size_t i) { hits[i]++; });
+  handle.wait();
+  for (auto& hit : hits) EXPECT_EQ(hit.load(), 1);
+}
+
+TEST(ThreadPoolTest, AddTasksMovesFromRvalueRange) {
+  ThreadPool pool(2);
+  std::atomic<int> counter{0};
+  auto make = [&counter](int value) {
+    return [p = std::make_unique<int>(value), &counter] {
+      counter.fetch_add(*p);
+    };
+  };
+  std::vector<decltype(make(0))> tasks;
+  for (int i = 1; i <= 10; i++) tasks.push_back(make(i));
+  pool.addTasks(std::move(tasks)).wait();
+  EXPECT_EQ(counter.load(), 55);
+}
+
+TEST(ThreadPoolTest, ParallelForHandlesRangeNearIndexLimit) {
+  ThreadPool pool(2);
+  std::atomic<int> chunks{0};
+  // 每个分块在第一个下标处抛出异常，只统计分块数
+  const int64_t end = std::numeric_limits<int64_t>::max();
+  auto handle = pool.parallelFor<int64_t>(0, end, end / 2 + 1,
+                                          [&chunks](int64_t) {
+                                            chunks++;
+                                            throw std::runtime_error("stop");
+                                          });
+  EXPECT_THROW(handle.wait(), std::runtime_error);
+  EXPECT_EQ(chunks.load(), 2);
+
+  // 整个有符号范围：end - begin 超出 int64_t
+  chunks = 0;
+  const int64_t begin = std::numeric_limits<int64_t>::min();
+  handle = pool.parallelFor<int64_t>(begin, end, end,
+                                     [&chunks](int64_t) {
+                                       chunks++;
+                                       throw std::runtime_error("stop");
+                                     });
+  EXPECT_THROW(handle.wait(), std::runtime_error);
+  EXPECT_EQ(chunks.load(), 3);
+}
+
+TEST(ThreadPoolTest, ParallelForRethrowsFirstException) {
+  ThreadPool pool(2);
+  std::atomic<int> visited{0};
+  auto handle = pool.parallelFor(0, 100, 10, [&visited](int i) {
+    visited++;
+    if (i == 55) throw std::runtime_error("bad index");
+  });
+  EXPECT_THROW(handle.wait(), std::runtime_error);
+  // 抛出异常只中断所在的分块，其他分块照常执行
+  EXPECT_EQ(visited.load(), 96);
+}
+
+TEST(ThreadPoolTest, BatchAfterStopThrows) {
+  ThreadPool pool(2);
+  pool.stop();
+  EXPECT_THROW(pool.parallelFor(0, 100, 1, [](int) {}), std::logic_error);
+}
+
+TEST(ThreadPoolTest, AcceptsMoveOnlyArguments) {
+  ThreadPool pool(2);
+  auto ptr = std::make_unique<int>(42);
+  auto fut = pool.addTask([](std::unique_ptr<int> p) { return *p; },
+                          std::move(ptr));
+  EXPECT_EQ(fut.get(), 42);
+}
+
+TEST(ThreadPoolTest, ReturnsReferenceAndLargeResults) {
+  ThreadPool pool(2);
+  int value = 7;
+  auto ref = pool.addTask([&value]() -> int& { return value; });
+  EXPECT_EQ(&ref.get(), &value);
+
+  // 超出回收池块大小的结果退回到堆上分配共享状态
+  struct Big {
+    char bytes[512];
+  };
+  auto big = pool.addTask([] {
+    Big b{};
+    b.bytes[511] = 'x';
+    return b;
+  });
+  EXPECT_EQ(big.get().bytes[511], 'x');
+}
+
+TEST(ThreadPoolTest, FutureOutlivesPool) {
+  TaskFuture<int> fut;
+  {
+    ThreadPool pool(1);
+    fut = pool.addTask([] { return 5; });
+  }
+  EXPECT_TRUE(fut.ready());
+  EXPECT_EQ(fut.get(), 5);
+  EXPECT_FALSE(fut.valid());
+}
+
+namespace {
+// 让单线程池的唯一工作线程阻塞，以便在它空出来之前排好队列。
+// 阻塞任务已被取走执行，不占用任何车道的队列容量
+struct WorkerBlocker {
+  explicit WorkerBlocker(ThreadPool& pool) {
+    std::promise<void> started;
+    auto gate = release.get_future().share();
+    done = pool.addTask(TaskPriority::kHigh, [gate, &started] {
+      started.set_value();
+      gate.wait();
+    });
+    started.get_future().wait();
+  }
+  void unblock() {
+    release.set_value();
+    done.get();
+  }
+
+  std::promise<void> release;
+  TaskFuture<void> done;
+};
+}  // namespace
+
+TEST(ThreadPoolTest, HigherPriorityRunsFirst) {
+  ThreadPool pool(1);
+  WorkerBlocker blocker(pool);
+
+  std::vector<int> order;
+  auto low = pool.addTask(TaskPriority::kLow, [&order] { order.push_back(3); });
+  auto normal = pool.addTask([&order] { order.push_back(2); });
+  auto high =
+      pool.addTask(TaskPriority::kHigh, [&order] { order.push_back(1); });
+  EXPECT_EQ(pool.queueDepth(TaskPriority::kHigh), 1u);
+  EXPECT_EQ(pool.queueDepth(TaskPriority::kNormal), 1u);
+  EXPECT_EQ(pool.queueDepth(TaskPriority::kLow), 1u);
+
+  blocker.unblock();
+  low.get();
+  normal.get();
+  high.get();
+  EXPECT_EQ(order, (std::vector<int>{1, 2, 3}));
+  EXPECT_EQ(pool.queueDepth(TaskPriority::kLow), 0u);
+}
+
+TEST(ThreadPoolTest, LowPriorityIsNotStarved) {
+  ThreadPool pool(1);
+  WorkerBlocker blocker(pool);
+
+  std::vector<int> order;
+  auto low =
+      pool.addTask(TaskPriority::kLow, [&order] { order.push_back(-1); });
+  std::vector<TaskFuture<void>> highs;
+  const int high_count = ThreadPool::kStarvationLimit * 3;
+  for (int i = 0; i < high_count; i++) {
+    highs.push_back(
+        pool.addTask(TaskPriority::kHigh, [&order, i] { order.push_back(i); }));
+  }
+
+  blocker.unblock();
+  low.get();
+  for (auto& high : highs) high.get();
+
+  // 低优先级任务在最多 kStarvationLimit 个高优先级任务之后就得到执行
+  auto pos = std::find(order.begin(), order.end(), -1) - order.begin();
+  EXPECT_LE(pos, static_cast<long>(ThreadPool::kStarvationLimit));
+}
+
+TEST(ThreadPoolTest, ElasticPoolGrowsAndRetires) {
+  ThreadPoolOptions options;
+  options.min_threads = 1;
+  options.max_threads = 4;
+  options.grow_latency = std::chrono::microseconds(1000);
+  options.idle_timeout = std::chrono::milliseconds(50);
+  ThreadPool pool(options);
+  EXPECT_EQ(pool.threadCount(), 1u);
+
+  // 唯一的常驻线程被占住，后续任务排队超过 grow_latency 后触发扩容
+  std::promise<void> release;
+  auto gate = release.get_future().share();
+  auto blocker = pool.addTask([gate] { gate.wait(); });
+  // 不假设多久之后一定扩容，持续提交直到扩容或超时
+  std::vector<TaskFuture<void>> futs;
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (pool.threadCount() == 1 &&
+         std::chrono::steady_clock::now() < deadline) {
+    futs.push_back(pool.addTask([] {}));
+    std::this_thread::sleep_for(options.grow_latency);
+  }
+  EXPECT_GT(pool.threadCount(), 1u);
+  for (auto& fut : futs) fut.get();
+
+  release.set_value();
+  blocker.get();
+
+  // 多出来的线程空闲超过 idle_timeout 后退出，回到 min_threads
+  deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (pool.threadCount() > 1 &&
+         std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  EXPECT_EQ(pool.threadCount(), 1u);
+
+  // 退出后的槽位可以被重新启用
+  EXPECT_EQ(pool.addTask([] { return 3; }).get(), 3);
+}
+
+TEST(ThreadPoolTest, BurstAfterIdleRunsInParallel) {
+  // ThreadPool(4) 在 CPU 少的机器上会被限制线程数，这里固定为 4 个
+  ThreadPoolOptions options;
+  options.min_threads = 4;
+  options.max_threads = 4;
+  ThreadPool pool(options);
+  // 每一轮提交 4 个任务，只有 4 个线程同时执行时它们才能都等到彼此。
+  // 每轮结束后线程重新进入自旋或休眠，提交方看到自旋线程时不会唤醒其他线程
+  for (int round = 0; round < 20; round++) {
+    std::atomic<int> arrived{0};
+    std::vector<TaskFuture<bool>> futs;
+    for (int i = 0; i < 4; i++) {
+      futs.push_back(pool.addTask([&arrived] {
+        arrived.fetch_add(1);
+        auto deadline =
+            std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while (arrived.load() < 4) {
+          if (std::chrono::steady_clock::now() > deadline) return false;
+          std::this_thread::yield();
+        }
+        return true;
+      }));
+    }
+    for (auto& fut : futs) ASSERT_TRUE(fut.get()) << "round " << round;
+  }
+}
+
+TEST(ThreadPoolTest, ParksImmediatelyWithoutSpinBudget) {
+  ThreadPoolOptions options;
+  options.min_threads = 2;
+  options.max_threads = 2;
+  options.spin_count = 0;
+  ThreadPool pool(options);
+  for (int i = 0; i < 100; i++) {
+    EXPECT_EQ(pool.addTask([i] { return i; }).get(), i);
+  }
+}
+
+TEST(ThreadPoolTest, ExplicitPlacementPinsWorkers) {
+  const unsigned int cpu = CpuTopology::detect().nodes.front().front();
+  ThreadPoolOptions options;
+  options.min_threads = 2;
+  options.max_threads = 2;
+  options.placement = WorkerPlacement::kExplicit;
+  options.cpus = {cpu};
+  ThreadPool pool(options);
+  for (int i = 0; i < 20; i++) {
+    const int running = pool.addTask([] { return currentCpu(); }).get();
+    // 不支持查询当前 CPU 的平台返回 -1
+    if (running < 0) continue;
+    EXPECT_EQ(static_cast<unsigned int>(running), cpu);
+  }
+}
+
+TEST(ThreadPoolTest, PlacementPoliciesRunTasks) {
+  for (auto placement :
+       {WorkerPlacement::kCompact, WorkerPlacement::kScatter}) {
+    ThreadPoolOptions options;
+    options.min_threads = 4;
+    options.max_threads = 4;
+    options.placement = placement;
+    ThreadPool pool(options);
+    std::atomic<int> counter{0};
+    pool.parallelFor(0, 1000, 10, [&counter](int) { counter.fetch_add(1); })
+        .wait();
+    EXPECT_EQ(counter.load(), 1000);
+  }
+}
+
+TEST(ThreadPoolTest, ExplicitPlacementNeedsCpuList) {
+  ThreadPoolOptions options;
+  options.placement = WorkerPlacement::kExplicit;
+  EXPECT_THROW(ThreadPool pool(options), std::invalid_argument);
+}
+
+TEST(ThreadPoolTest, HistogramBucketsArePowersOfTwo) {
+  EXPECT_EQ(LatencyHistogram::bucketOf(0), 0u);
+  EXPECT_EQ(LatencyHistogram::bucketOf(1), 1u);
+  EXPECT_EQ(LatencyHistogram::bucketOf(3), 2u);
+  EXPECT_EQ(LatencyHistogram::bucketOf(1024), 11u);
+  EXPECT_EQ(LatencyHistogram::bucketOf(UINT64_MAX),
+            LatencyHistogram::kBuckets - 1);
+
+  LatencyHistogram histogram;
+  EXPECT_EQ(histogram.percentile(0.5).count(), 0);
+  histogram.counts[4] = 90;   // [8, 16) ns
+  histogram.counts[10] = 10;  // [512, 1024) ns
+  EXPECT_EQ(histogram.total(), 100u);
+  EXPECT_EQ(histogram.percentile(0.5).count(), 15);
+  EXPECT_EQ(histogram.percentile(0.99).count(), 1023);
+}
+
+TEST(ThreadPoolTest, SnapshotCountsTasksAndSteals) {
+  ThreadPool pool(2);
+  // 与 IdleWorkerStealsFromBusyWorker 相同：内层任务只能被另一个线程窃取
+  auto outer = pool.addTask([&pool] {
+    auto inner = pool.addTask([] {});
+    inner.get();
+  });
+  outer.get();
+  std::vector<TaskFuture<void>> futs;
+  for (int i = 0; i < 100; i++) futs.push_back(pool.addTask([] {}));
+  for (auto& fut : futs) fut.get();
+
+  // 计数在任务返回后才更新，future 就绪时可能还没写入
+  ThreadPoolStats stats;
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  std::uint64_t tasks = 0;
+  do {
+    stats = pool.snapshot();
+    tasks = 0;
+    for (const auto& worker : stats.workers) tasks += worker.tasks;
+  } while (tasks < 102 && std::chrono::steady_clock::now() < deadline);
+
+  EXPECT_EQ(tasks, 102u);
+  EXPECT_EQ(stats.threads, 2u);
+  ASSERT_EQ(stats.workers.size(), 2u);
+  std::uint64_t steals = 0;
+  for (const auto& worker : stats.workers) {
+    EXPECT_TRUE(worker.active);
+    steals += worker.steals;
+  }
+  EXPECT_GE(steals, 1u);
+  EXPECT_EQ(stats.queue_wait.total(), 102u);
+  EXPECT_EQ(stats.run_time.total(), 102u);
+  EXPECT_EQ(stats.queue_depth[0] + stats.queue_depth[1] + stats.queue_depth[2],
+            0u);
+}
+
+namespace {
+ThreadPoolOptions ringOptions(unsigned int threads, size_t capacity,
+                              OverflowPolicy overflow) {
+  ThreadPoolOptions options;
+  options.min_threads = threads;
+  options.max_threads = threads;
+  options.backend = QueueBackend::kLockFreeRing;
+  options.queue_capacity = capacity;
+  options.overflow = overflow;
+  return options;
+}
+}  // namespace
+
+TEST(ThreadPoolTest, LockFreeRingRunsAllTasks) {
+  ThreadPool pool(ringOptions(4, 64, OverflowPolicy::kBlock));
+  std::atomic<int> counter{0};
+  std::vector<TaskFuture<void>> futs;
+  for (int i = 0; i < 1000; i++) {
+    futs.push_back(pool.addTask([&pool, &counter] {
+      // 工作线程内提交，本地环满时就地执行
+      pool.addTask([&counter] { counter.fetch_add(1); });
+      counter.fetch_add(1);
+    }));
+  }
+  for (auto& fut : futs) fut.get();
+  pool.parallelFor(0, 1000, 1, [&counter](int) { counter.fetch_add(1); })
+      .wait();
+  pool.stop();
+  // stop() 后已入队的任务仍会执行完，等到计数稳定
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (counter.load() < 3000 && std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::yield();
+  }
+  EXPECT_EQ(counter.load(), 3000);
+}
+
+TEST(ThreadPoolTest, RingOverflowRejects) {
+  ThreadPool pool(ringOptions(1, 2, OverflowPolicy::kReject));
+  WorkerBlocker blocker(pool);
+  auto a = pool.addTask([] { return 1; });
+  auto b = pool.addTask([] { return 2; });
+  EXPECT_THROW(pool.addTask([] { return 3; }), std::overflow_error);
+  // 其他车道有独立的容量
+  auto c = pool.addTask(TaskPriority::kHigh, [] { return 4; });
+  blocker.unblock();
+  EXPECT_EQ(a.get() + b.get() + c.get(), 7);
+}
+
+TEST(ThreadPoolTest, RingOverflowRunsInline) {
+  ThreadPool pool(ringOptions(1, 2, OverflowPolicy::kRunInline));
+  WorkerBlocker blocker(pool);
+  pool.addTask([] {});
+  pool.addTask([] {});
+  auto inline_run = pool.addTask([] { return std::this_thread::get_id(); });
+  ASSERT_TRUE(inline_run.ready());
+  EXPECT_EQ(inline_run.get(), std::this_thread::get_id());
+  blocker.unblock();
+}
+
+TEST(ThreadPoolTest, RingOverflowBlocksUntilSpace) {
+  ThreadPool pool(ringOptions(1, 2, OverflowPolicy::kBlock));
+  WorkerBlocker blocker(pool);
+  pool.addTask([] {});
+  pool.addTask([] {});
+  std::atomic<bool> submitted{false};
+  std::promise<void> submitting;
+  std::thread producer([&pool, &submitted, &submitting] {
+    submitting.set_value();
+    auto fut = pool.addTask([] { return 5; });
+    submitted = true;
+    EXPECT_EQ(fut.get(), 5);
+  });
+  // 队列一直是满的，工作线程放行之前提交不可能返回
+  submitting.get_future().wait();
+  EXPECT_FALSE(submitted.load());
+  blocker.unblock();
+  producer.join();
+  EXPECT_TRUE(submitted.load());
+}
+
+TEST(ThreadPoolTest, ThenChainsWithoutBlockingWorkers) {
+  // 单线程池上的长链：每一步都在前一步就绪后才提交，不占用工作线程等待
+  ThreadPool pool(1);
+  auto fut = pool.addTask([] { return 0; });
+  for (int i = 0; i < 100; i++) {
+    fut = fut.then(pool, [](TaskFuture<int> prev) { return prev.get() + 1; });
+  }
+  EXPECT_EQ(fut.get(), 100);
+
+  // 前驱的异常通过传入的 future 交给后续任务处理
+  auto failed = pool.addTask([]() -> int { throw std::runtime_error("boom"); })
+                    .then(pool, [](TaskFuture<int> prev) {
+                      try {
+                        return prev.get();
+                      } catch (const std::runtime_error&) {
+                        return -1;
+                      }
+                    });
+  EXPECT_EQ(failed.get(), -1);
+}
+
+TEST(ThreadPoolTest, ThenOnReadyFutureRunsOnPool) {
+  ThreadPool pool(2);
+  auto first = pool.addTask([] { return std::this_thread::get_id(); });
+  first.wait();
+  auto next = first.then(pool, [](TaskFuture<std::thread::id> prev) {
+    prev.get();
+    return std::this_thread::get_id();
+  });
+  EXPECT_NE(next.get(), std::this_thread::get_id());
+  EXPECT_FALSE(first.valid());
+}
+
+TEST(ThreadPoolTest, WhenAllCollectsInputs) {
+  ThreadPool pool(2);
+  std::vector<TaskFuture<int>> futs;
+  for (int i = 0; i < 50; i++) futs.push_back(pool.addTask([i] { return i; }));
+  auto sum = whenAll(std::move(futs))
+                 .then(pool, [](TaskFuture<std::vector<TaskFuture<int>>> all) {
+                   int total = 0;
+                   for (auto& fut : all.get()) total += fut.get();
+                   return total;
+                 });
+  EXPECT_EQ(sum.get(), 50 * 49 / 2);
+
+  auto both = whenAll(pool.addTask([] { return 1; }),
+                      pool.addTask([] { return std::string("two"); }))
+                  .get();
+  EXPECT_EQ(std::get<0>(both).get(), 1);
+  EXPECT_EQ(std::get<1>(both).get(), "two");
+
+  EXPECT_TRUE(whenAll(std::vector<TaskFuture<int>>{}).get().empty());
+}
+
+TEST(ThreadPoolTest, WhenAnyReportsFirstReady) {
+  ThreadPool pool(2);
+  std::promise<void> release;
+  auto gate = release.get_future().share();
+  std::vector<TaskFuture<int>> futs;
+  futs.push_back(pool.addTask([gate] {
+    gate.wait();
+    return 1;
+  }));
+  futs.push_back(pool.addTask([] { return 2; }));
+  auto any = whenAny(std::move(futs)).get();
+  EXPECT_EQ(any.index, 1u);
+  EXPECT_EQ(any.futures[1].get(), 2);
+  release.set_value();
+  EXPECT_EQ(any.futures[0].get(), 1);
+
+  EXPECT_EQ(whenAny(std::vector<TaskFuture<int>>{}).get().index,
+            static_cast<size_t>(-1));
+}
+
+TEST(ThreadPoolTest, CancelledTaskIsDroppedWithoutRunning) {
+  ThreadPool pool(1);
+  WorkerBlocker blocker(pool);
+  CancellationSource source;
+  std::atomic<bool> ran{false};
+  auto cancelled = pool.addTask(source.token(), [&ran] { ran = true; });
+  auto kept = pool.addTask(CancellationToken(), [] { return 7; });
+  source.cancel();
+  blocker.unblock();
+
+  EXPECT_THROW(cancelled.get(), TaskCancelled);
+  EXPECT_FALSE(ran.load());
+  EXPECT_EQ(kept.get(), 7);
+
+  // 已取消的来源派生的令牌同样生效，且支持指定优先级
+  auto late = pool.addTask(source.token(), TaskPriority::kHigh, [] {});
+  EXPECT_THROW(late.get(), TaskCancelled);
+}
+
+TEST(ThreadPoolTest, DrainForFinishesQueuedTasks) {
+  ThreadPool pool(2);
+  std::atomic<int> counter{0};
+  for (int i = 0; i < 100; i++) {
+    pool.addTask([&counter] { counter.fetch_add(1); });
+  }
+  EXPECT_TRUE(pool.drainFor(std::chrono::seconds(5)));
+  EXPECT_EQ(counter.load(), 100);
+  EXPECT_EQ(pool.threadCount(), 0u);
+  EXPECT_THROW(pool.addTask([] {}), std::logic_error);
+}
+
+TEST(ThreadPoolTest, DrainForDropsWorkPastDeadline) {
+  ThreadPool pool(1);
+  WorkerBlocker blocker(pool);
+  auto queued = pool.addTask([] { return 1; });
+  EXPECT_FALSE(pool.drainFor(std::chrono::milliseconds(20)));
+  blocker.unblock();
+  EXPECT_THROW(queued.get(), std::future_error);
+}
+
+TEST(ThreadPoolTest, AddTaskAfterWaitsForDelay) {
+  ThreadPool pool(2);
+  std::promise<std::chrono::steady_clock::time_point> fired;
+  const auto start = std::chrono::steady_clock::now();
+  pool.addTaskAfter(std::chrono::milliseconds(30), [&fired] {
+    fired.set_value(std::chrono::steady_clock::now());
+  });
+  auto future = fired.get_future();
+  ASSERT_EQ(future.wait_for(std::chrono::seconds(5)),
+            std::future_status::ready);
+  EXPECT_GE(future.get() - start, std::chrono::milliseconds(30));
+}
+
+TEST(ThreadPoolTest, CancelledTimerNeverFires) {
+  ThreadPool pool(2);
+  std::atomic<bool> ran{false};
+  auto handle = pool.addTaskAfter(std::chrono::milliseconds(20),
+                                  [&ran] { ran = true; });
+  EXPECT_TRUE(handle.cancel());
+  EXPECT_FALSE(handle.cancel());
+
+  // 更晚到期的定时器触发时，已取消的定时器必定已经过期
+  std::promise<void> later;
+  pool.addTaskAfter(std::chrono::milliseconds(40),
+                    [&later] { later.set_value(); });
+  later.get_future().wait();
+  EXPECT_FALSE(ran.load());
+
+  // 一次性任务执行后不能再取消
+  std::promise<void> done;
+  auto fired = pool.addTaskAfter(std::chrono::milliseconds(0),
+                                 [&done] { done.set_value(); });
+  done.get_future().wait();
+  EXPECT_FALSE(fired.cancel());
+  EXPECT_FALSE(ThreadPool::TimerHandle().cancel());
+}
+
+TEST(ThreadPoolTest, PeriodicTaskRepeatsUntilCancelled) {
+  ThreadPool pool(2);
+  std::atomic<int> count{0};
+  std::promise<ThreadPool::TimerHandle> handle;
+  std::promise<bool> cancelled;
+  // 在第 5 次执行中取消：同一个 fn 不会并发执行，
+  // 之后即使还有已到期的触发也会被跳过，计数停在 5
+  auto timer = pool.addPeriodic(
+      std::chrono::milliseconds(2),
+      [&count, &cancelled, shared = handle.get_future().share()] {
+        if (count.fetch_add(1) + 1 != 5) return;
+        ThreadPool::TimerHandle self = shared.get();
+        cancelled.set_value(self.cancel());
+      });
+  handle.set_value(timer);
+  EXPECT_TRUE(cancelled.get_future().get());
+  EXPECT_FALSE(timer.cancel());
+
+  // 更晚到期的定时器执行完时，取消前到期的触发都已处理
+  std::promise<void> later;
+  pool.addTaskAfter(std::chrono::milliseconds(20),
+                    [&later] { later.set_value(); });
+  later.get_future().wait();
+  EXPECT_EQ(count.load(), 5);
+
+  EXPECT_THROW(pool.addPeriodic(std::chrono::milliseconds(0), [] {}),
+               std::invalid_argument);
+}
+
+TEST(ThreadPoolTest, TimersBypassRingOverflowPolicy) {
+  for (auto policy : {OverflowPolicy::kRunInline, OverflowPolicy::kBlock}) {
+    ThreadPool pool(ringOptions(1, 2, policy));
+    WorkerBlocker blocker(pool);
+    pool.addTask([] {});
+    pool.addTask([] {});
+
+    // 环已满：第一个定时任务既不能在定时线程上执行，也不能让它阻塞，
+    // 否则第二个定时任务无法按时入队
+    std::atomic<int> ran{0};
+    std::promise<void> first;
+    std::promise<void> second;
+    const auto start = std::chrono::steady_clock::now();
+    pool.addTaskAfter(std::chrono::milliseconds(0), [&ran, &first] {
+      ran.fetch_add(1);
+      first.set_value();
+    });
+    pool.addTaskAfter(std::chrono::milliseconds(10), [&ran, &second] {
+      ran.fetch_add(1);
+      second.set_value();
+    });
+    auto deadline = start + std::chrono::seconds(5);
+    while (pool.queueDepth(TaskPriority::kNormal) < 4 &&
+           std::chrono::steady_clock::now() < deadline) {
+      std::this_thread::yield();
+    }
+    EXPECT_EQ(pool.queueDepth(TaskPriority::kNormal), 4u);
+    EXPECT_LT(std::chrono::steady_clock::now() - start,
+              std::chrono::seconds(1));
+    EXPECT_EQ(ran.load(), 0);
+
+    blocker.unblock();
+    first.get_future().wait();
+    second.get_future().wait();
+    EXPECT_EQ(ran.load(), 2);
+  }
+}
+
+TEST(ThreadPoolTest, ManyTimersInsertAndCancelQuickly) {
+  ThreadPool pool(2);
+  std::atomic<int> fired{0};
+  std::vector<ThreadPool::TimerHandle> handles;
+  const int count = 200000;
+  handles.reserve(count);
+  for (int i = 0; i < count; i++) {
+    handles.push_back(pool.addTaskAfter(std::chrono::seconds(60 + i % 3600),
+                                        [&fired] { fired.fetch_add(1); }));
+  }
+  for (auto& handle : handles) EXPECT_TRUE(handle.cancel());
+  EXPECT_EQ(fired.load(), 0);
+
+  pool.stop();
+  EXPECT_THROW(pool.addTaskAfter(std::chrono::milliseconds(1), [] {}),
+               std::logic_error);
+}
+
+TEST(ThreadPoolTest, PendingTimersAreDroppedOnDestruction) {
+  std::atomic<bool> ran{false};
+  auto token = std::make_shared<int>(0);
+  {
+    ThreadPool pool(1);
+    pool.addTaskAfter(std::chrono::hours(1), [&ran, token] { ran = true; });
+  }
+  EXPECT_FALSE(ran.load());
+  // 定时任务及其捕获的对象随线程池释放
+  EXPECT_EQ(token.use_count(), 1);
+}
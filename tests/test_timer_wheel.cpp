@@ -0,0 +1,81 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <map>
+#include <random>
+#include <vector>
+
+#include "playground/threading/timer_wheel.hpp"
+
+using namespace playground;
+
+namespace {
+struct TestTimer : TimerWheel::Node {
+  int id = 0;
+  std::uint64_t fired_at = 0;
+};
+}  // namespace
+
+TEST(TimerWheelTest, FiresExactlyAtExpiryAcrossLevels) {
+  TimerWheel wheel(10);
+  // 覆盖第 0 层、各级高层以及超出最高层范围的到期时间
+  const std::uint64_t delays[] = {1,      5,       63,       64,       65,
+                                  4095,   4096,    4097,     300000,
+                                  1 << 24, (1 << 24) + 77};
+  std::vector<TestTimer> timers(std::size(delays));
+  for (size_t i = 0; i < timers.size(); i++) {
+    timers[i].id = static_cast<int>(i);
+    wheel.insert(&timers[i], 10 + delays[i]);
+  }
+  EXPECT_EQ(wheel.size(), timers.size());
+
+  // 按 nextTick() 推进，与定时线程的用法一致
+  while (!wheel.empty()) {
+    const std::uint64_t next = wheel.nextTick();
+    ASSERT_NE(next, TimerWheel::kNever);
+    wheel.advanceTo(next, [&wheel](TimerWheel::Node* node) {
+      static_cast<TestTimer*>(node)->fired_at = wheel.now();
+    });
+  }
+  for (size_t i = 0; i < timers.size(); i++) {
+    EXPECT_EQ(timers[i].fired_at, 10 + delays[i]) << "delay " << delays[i];
+  }
+  EXPECT_EQ(wheel.nextTick(), TimerWheel::kNever);
+}
+
+TEST(TimerWheelTest, RemovedTimersNeverFire) {
+  TimerWheel wheel;
+  std::vector<TestTimer> timers(1000);
+  std::mt19937 rng(42);
+  for (auto& timer : timers) wheel.insert(&timer, 1 + rng() % 100000);
+  for (size_t i = 0; i < timers.size(); i += 2) wheel.remove(&timers[i]);
+  // 重复删除是空操作
+  wheel.remove(&timers[0]);
+  EXPECT_EQ(wheel.size(), 500u);
+
+  int fired = 0;
+  wheel.advanceTo(200000, [&](TimerWheel::Node* node) {
+    const auto index = static_cast<TestTimer*>(node) - timers.data();
+    EXPECT_EQ(index % 2, 1);
+    EXPECT_EQ(node->expiry, wheel.now());
+    fired++;
+  });
+  EXPECT_EQ(fired, 500);
+  EXPECT_TRUE(wheel.empty());
+}
+
+TEST(TimerWheelTest, FireCanReinsert) {
+  TimerWheel wheel;
+  TestTimer timer;
+  wheel.insert(&timer, 100);
+  std::vector<std::uint64_t> ticks;
+  wheel.advanceTo(1000, [&](TimerWheel::Node* node) {
+    ticks.push_back(wheel.now());
+    if (ticks.size() < 5) wheel.insert(node, wheel.now() + 100);
+  });
+  EXPECT_EQ(ticks, (std::vector<std::uint64_t>{100, 200, 300, 400, 500}));
+
+  // 过期时间不晚于当前 tick 的定时器在下一个 tick 触发
+  wheel.insert(&timer, 3);
+  EXPECT_EQ(wheel.nextTick(), 1001u);
+}
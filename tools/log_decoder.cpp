@@ -0,0 +1,55 @@
+// 把 CAsyncLog::setBinaryFile 写出的二进制日志还原成文本，输出到标准输出。
+// 用法：log_decoder [日志文件...]，不指定文件时读取标准输入
+#include <stdio.h>
+
+#include <exception>
+#include <string>
+
+#include "playground/threading/log_record.h"
+
+namespace {
+// 解码成功返回 true；每个文件自带格式定义，用单独的解码器
+bool decodeFile(FILE* pFile, const char* pszName) {
+  playground::LogDecoder decoder;
+  std::string strPending;
+  std::string strText;
+  char szBuf[64 * 1024];
+  try {
+    size_t n;
+    while ((n = fread(szBuf, 1, sizeof(szBuf), pFile)) > 0) {
+      strPending.append(szBuf, n);
+      const size_t nUsed =
+          decoder.decode(strPending.data(), strPending.size(), strText);
+      strPending.erase(0, nUsed);
+      fwrite(strText.data(), 1, strText.size(), stdout);
+      strText.clear();
+    }
+  } catch (const std::exception& e) {
+    fprintf(stderr, "log_decoder: %s: %s\n", pszName, e.what());
+    return false;
+  }
+  if (!strPending.empty()) {
+    fprintf(stderr, "log_decoder: %s: truncated frame at end of file\n",
+            pszName);
+    return false;
+  }
+  return true;
+}
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  if (argc < 2) return decodeFile(stdin, "<stdin>") ? 0 : 1;
+
+  bool bOk = true;
+  for (int i = 1; i < argc; i++) {
+    FILE* pFile = fopen(argv[i], "rb");
+    if (pFile == nullptr) {
+      fprintf(stderr, "log_decoder: cannot open %s\n", argv[i]);
+      bOk = false;
+      continue;
+    }
+    bOk = decodeFile(pFile, argv[i]) && bOk;
+    fclose(pFile);
+  }
+  return bOk ? 0 : 1;
+}